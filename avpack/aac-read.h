@@ -16,6 +16,7 @@ aacadts_find
 #include <avpack/decl.h>
 #include <avpack/base/adts.h>
 #include <ffbase/stream.h>
+#include <ffbase/vector.h>
 
 
 enum AACREAD_R {
@@ -26,6 +27,7 @@ enum AACREAD_R {
 	AACREAD_SEEK = AVPK_SEEK,
 	AACREAD_ERROR = AVPK_ERROR,
 	AACREAD_WARN = AVPK_WARNING,
+	AACREAD_DONE = AVPK_FIN, // the seek target is beyond the last frame
 };
 
 enum AACREAD_OPT {
@@ -42,7 +44,7 @@ typedef struct aacread {
 	ffuint state, nextstate;
 	ffuint gather_size;
 	const char *error;
-	ffuint64 pos, seek, size, duration, off;
+	ffuint64 pos, seek, size, off;
 	ffuint frlen;
 	ffstream stream;
 	ffstr chunk;
@@ -52,8 +54,16 @@ typedef struct aacread {
 
 	struct aacread_info info;
 	ffuint options; // enum AACREAD_OPT
+
+	ffvec index; // ffuint64[]: offsets of every AACREAD_INDEX_INTERVAL-th frame
+	ffuint64 seek_frame;
+	ffuint skip;
 } aacread;
 
+enum {
+	AACREAD_INDEX_INTERVAL = 16,
+};
+
 static inline const char* aacread_error(aacread *a)
 {
 	return a->error;
@@ -74,6 +84,7 @@ static inline void aacread_open2(aacread *a, struct avpk_reader_conf *conf)
 static inline void aacread_close(aacread *a)
 {
 	ffstream_free(&a->stream);
+	ffvec_free(&a->index);
 }
 
 /** Search for header
@@ -157,12 +168,27 @@ static int _aacread_hdr_find(aacread *a, ffstr *input, ffstr *out)
 	return 0;
 }
 
+/** Add frame offset to the seek index if it's the next Nth frame */
+static void _aacread_index_add(aacread *a, ffuint64 frame, ffuint64 off)
+{
+	if (frame != (ffuint64)a->index.len * AACREAD_INDEX_INTERVAL)
+		return;
+	ffuint64 *p;
+	if (NULL == (p = ffvec_pushT(&a->index, ffuint64)))
+		return;
+	*p = off;
+}
+
 /** Return enum AACREAD_R */
+/* Seeking:
+. Find the nearest indexed frame before the target and seek to it
+. Skip frames (read headers only) until the target frame is reached, add skipped frames to the index
+. Stop at the end of file if the target is beyond the last frame */
 static inline int aacread_process(aacread *a, ffstr *input, ffstr *output)
 {
 	enum {
 		R_HDR_FIND, R_HDR2, R_HDR, R_CRC, R_DATA, R_FR,
-		R_GATHER,
+		R_GATHER, R_SKIP_HDR, R_SKIP,
 		R_SEEK = 10,
 	};
 	int r;
@@ -174,8 +200,11 @@ static inline int aacread_process(aacread *a, ffstr *input, ffstr *output)
 			r = ffstream_gather(&a->stream, *input, a->gather_size, &a->chunk);
 			ffstr_shift(input, r);
 			a->off += r;
-			if (a->chunk.len < a->gather_size)
+			if (a->chunk.len < a->gather_size) {
+				if (a->nextstate == R_SKIP_HDR && a->off >= a->size)
+					return AACREAD_DONE;
 				return AACREAD_MORE;
+			}
 			a->chunk.len = a->gather_size;
 			a->state = a->nextstate;
 			continue;
@@ -221,6 +250,7 @@ static inline int aacread_process(aacread *a, ffstr *input, ffstr *output)
 				return a->error = "lost synchronization",  AACREAD_WARN;
 			}
 
+			_aacread_index_add(a, a->pos / 1024, a->off - ffstream_used(&a->stream));
 			a->frlen = h.framelen;
 			a->state = R_GATHER,  a->nextstate = R_DATA,  a->gather_size = h.framelen;
 			if (a->options & AACREAD_WHOLEFRAME)
@@ -244,12 +274,49 @@ static inline int aacread_process(aacread *a, ffstr *input, ffstr *output)
 			*output = a->chunk;
 			return AACREAD_DATA;
 
-		case R_SEEK:
+		case R_SEEK: {
+			ffuint64 i = ffmin(a->seek_frame / AACREAD_INDEX_INTERVAL, a->index.len - 1);
+			a->pos = i * AACREAD_INDEX_INTERVAL * 1024;
+			a->off = *ffslice_itemT(&a->index, i, ffuint64);
 			ffstream_reset(&a->stream);
-			a->state = R_HDR_FIND;
-			a->off = a->pos * a->size / a->duration;
+			a->state = R_GATHER,  a->nextstate = R_SKIP_HDR,  a->gather_size = 7;
 			return AACREAD_SEEK;
 		}
+
+		case R_SKIP_HDR:
+			if (!(adts_hdr_read(&h, a->chunk.ptr, a->chunk.len) > 0
+				&& adts_hdr_match(a->first_hdr, a->chunk.ptr))) {
+				a->state = R_HDR_FIND;
+				return a->error = "lost synchronization",  AACREAD_WARN;
+			}
+
+			if (a->pos / 1024 == a->seek_frame) {
+				a->state = R_HDR;
+				continue;
+			}
+
+			_aacread_index_add(a, a->pos / 1024, a->off - ffstream_used(&a->stream));
+			a->pos += 1024;
+			r = ffmin(ffstream_used(&a->stream), h.framelen);
+			ffstream_consume(&a->stream, r);
+			a->skip = h.framelen - r;
+			a->state = R_SKIP;
+			// fallthrough
+
+		case R_SKIP:
+			// skip frame body without copying
+			r = ffmin(input->len, a->skip);
+			ffstr_shift(input, r);
+			a->off += r;
+			a->skip -= r;
+			if (a->skip != 0) {
+				if (a->off >= a->size)
+					return AACREAD_DONE;
+				return AACREAD_MORE;
+			}
+			a->state = R_GATHER,  a->nextstate = R_SKIP_HDR,  a->gather_size = 7;
+			continue;
+		}
 	}
 }
 
@@ -302,9 +369,9 @@ static inline const struct aacread_info* aacread_info(aacread *a)
 static inline void aacread_seek(aacread *a, ffuint64 sample)
 {
 	a->seek = ffint_align_floor2(sample, 1024);
-	if (!a->size || !a->duration)
-		return;
-	a->pos = a->seek;
+	if (!a->size || a->index.len == 0)
+		return; // skip frames until the target is reached
+	a->seek_frame = a->seek / 1024;
 	a->seek = 0;
 	a->state = 10; // R_SEEK
 }
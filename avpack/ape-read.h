@@ -18,8 +18,7 @@ aperead_align4
 #pragma once
 #include <avpack/decl.h>
 #include <avpack/base/ape.h>
-#include <avpack/id3v1.h>
-#include <avpack/apetag.h>
+#include <avpack/tailtag.h>
 #include <ffbase/vector.h>
 
 typedef struct aperead {
@@ -37,11 +36,11 @@ typedef struct aperead {
 	ffuint iblock;
 	ffuint align4;
 	ffuint shift;
+	ffuint overlap; // N of bytes shared with the previous block; located right before input data
 	ffuint *seektab;
 	ffuint64 seek_sample;
 
-	struct id3v1read id3v1;
-	struct apetagread apetag;
+	struct tailtagread tail;
 	ffstr tagname, tagval;
 	int tag;
 } aperead;
@@ -77,21 +76,26 @@ static inline void aperead_open(aperead *a, ffuint64 total_size)
 static inline void aperead_open2(aperead *a, struct avpk_reader_conf *conf)
 {
 	aperead_open(a, !(conf->flags & AVPKR_F_NO_SEEK) ? conf->total_size : 0);
+	a->tail.id3v1.codepage = conf->code_page;
+	a->tail.codepage = conf->code_page;
+	a->tail.window = conf->tail_size;
 }
 
 static inline void aperead_close(aperead *a)
 {
 	ffvec_free(&a->buf);
-	apetagread_close(&a->apetag);
+	tailtagread_close(&a->tail);
 	ffmem_free(a->seektab);  a->seektab = NULL;
 }
 
 /**
+Output data: block data starting at 4-byte aligned offset, the first aperead_align4() bytes are not used.
+ Points to the input data, unless the block is split between several input buffers.
 Return enum APEREAD_R */
 static inline int aperead_process(aperead *a, ffstr *input, ffstr *output)
 {
 	enum {
-		R_FTR_SEEK, R_ID3V1, R_APETAG_FTR, R_APETAG, R_HDR_SEEK,
+		R_FTR_SEEK, R_TAILTAG, R_HDR_SEEK,
 		R_HDR, R_SEEKTAB, R_BLOCK_GATHER, R_BLOCK,
 		R_GATHER,
 	};
@@ -125,6 +129,7 @@ static inline int aperead_process(aperead *a, ffstr *input, ffstr *output)
 					return _APER_ERR(a, "can't seek");
 				a->seek_sample = (ffuint64)-1;
 				a->shift = 0;
+				a->overlap = 0;
 				ffuint align4 = (a->seektab[a->iblock] - a->seektab[0]) % 4;
 				a->off = a->seektab[a->iblock] - align4;
 				return APEREAD_SEEK;
@@ -135,9 +140,14 @@ static inline int aperead_process(aperead *a, ffstr *input, ffstr *output)
 				ffuint off2 = a->seektab[a->iblock + 1];
 				ffuint align4 = (off2 - a->seektab[0]) % 4;
 				if (align4 != 0) {
-					// preserve the trailing bytes in the buffer
-					ffmem_move(a->buf.ptr, &a->chunk.ptr[a->chunk.len - 4], 4);
-					a->buf.len = 4;
+					if (a->chunk.ptr != a->buf.ptr) {
+						// the trailing bytes are still in the user's buffer
+						a->overlap = 4;
+					} else {
+						// preserve the trailing bytes in the buffer
+						ffmem_move(a->buf.ptr, &a->chunk.ptr[a->chunk.len - 4], 4);
+						a->buf.len = 4;
+					}
 				}
 				a->iblock++;
 			}
@@ -169,6 +179,23 @@ static inline int aperead_process(aperead *a, ffstr *input, ffstr *output)
 			return APEREAD_DATA;
 
 		case R_GATHER:
+			if (a->overlap != 0) {
+				if (a->overlap + input->len >= a->gather_size) {
+					// the whole block is in input: no copying
+					r = a->gather_size - a->overlap;
+					ffstr_set(&a->chunk, input->ptr - a->overlap, a->gather_size);
+					a->overlap = 0;
+					ffstr_shift(input, r);
+					a->off += r;
+					a->state = a->nextstate;
+					continue;
+				}
+
+				// the block is split between input buffers
+				ffvec_add(&a->buf, input->ptr - a->overlap, a->overlap, 1);
+				a->overlap = 0;
+			}
+
 			r = ffstr_gather((ffstr*)&a->buf, &a->buf.cap, input->ptr, input->len, a->gather_size, &a->chunk);
 			if (r < 0)
 				return _APER_ERR(a, "not enough memory");
@@ -187,82 +214,35 @@ static inline int aperead_process(aperead *a, ffstr *input, ffstr *output)
 				continue;
 			}
 
-			a->state = R_GATHER,  a->nextstate = R_ID3V1;
-			a->gather_size = sizeof(struct apetaghdr) + sizeof(struct id3v1);
-			a->gather_size = ffmin(a->gather_size, a->total_size);
-			a->off = a->total_size - a->gather_size;
-			return APEREAD_SEEK;
-
-		case R_ID3V1: {
-			if (sizeof(struct id3v1) > a->chunk.len) {
-				a->state = R_APETAG_FTR;
-				continue;
-			}
-
-			ffstr id3;
-			ffstr_set(&id3, &a->chunk.ptr[a->chunk.len - sizeof(struct id3v1)], sizeof(struct id3v1));
-			r = id3v1read_process(&a->id3v1, id3, &a->tagval);
-
-			switch (r) {
-			case ID3V1READ_DONE:
-				a->total_size -= sizeof(struct id3v1);
-				a->chunk.len -= sizeof(struct id3v1);
-				a->off -= sizeof(struct id3v1);
-				break;
-
-			case ID3V1READ_NO:
-				break;
-
-			default:
-				a->tag = -r;
-				return APEREAD_ID31;
-			}
-		}
+			tailtagread_open(&a->tail, a->total_size);
+			a->state = R_TAILTAG;
 			// fallthrough
 
-		case R_APETAG_FTR: {
-			apetagread_open(&a->apetag);
-			ffint64 seek;
-			r = apetagread_footer(&a->apetag, a->chunk, &seek);
+		case R_TAILTAG:
+			r = tailtagread_process(&a->tail, input, &a->tagname, &a->tagval);
 
 			switch (r) {
-			case APETAGREAD_SEEK:
-				a->off += seek;
-				a->total_size = a->off;
-				a->state = R_APETAG;
+			case TAILTAGREAD_SEEK:
+				a->off = tailtagread_offset(&a->tail);
 				return APEREAD_SEEK;
 
-			default:
-				a->state = R_HDR_SEEK;
-				continue;
-			}
-			break;
-		}
-
-		case R_APETAG: {
-			ffsize len = input->len;
-			r = apetagread_process(&a->apetag, input, &a->tagname, &a->tagval);
-			a->off += len - input->len;
-
-			switch (r) {
-			case APETAGREAD_MORE:
+			case TAILTAGREAD_MORE:
 				return APEREAD_MORE;
 
-			case APETAGREAD_DONE:
-				apetagread_close(&a->apetag);
-				a->state = R_HDR_SEEK;
-				break;
+			case TAILTAGREAD_WARN:
+				a->error = tailtagread_error(&a->tail);
+				return APEREAD_WARN;
 
-			case APETAGREAD_ERROR:
+			case TAILTAGREAD_DONE:
+				a->total_size = a->tail.total_size;
+				tailtagread_close(&a->tail);
 				a->state = R_HDR_SEEK;
-				a->error = apetagread_error(&a->apetag);
-				return APEREAD_WARN;
+				break;
 
 			default:
 				a->tag = -r;
 				return APEREAD_APETAG;
 			}
-		}
 			// fallthrough
 
 		case R_HDR_SEEK:
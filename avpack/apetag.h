@@ -3,6 +3,7 @@
 */
 
 /*
+apetag_find
 apetagread_open apetagread_close
 apetagread_footer
 apetagread_process
@@ -66,6 +67,15 @@ static const ffbyte _apetag_int[] = {
 	MMTAG_DATE,
 };
 
+/** Get MMTAG by field name (case-insensitive).
+Return enum MMTAG */
+static inline int apetag_find(const char *name, ffsize len)
+{
+	ffuint i = _apetag_hash[_mmtag_hash_str(name, len, APETAG_HASH_SEED, APETAG_HASH_BITS)];
+	if (i == 0 || !_mmtag_ieq(name, len, _apetag_str[i - 1]))
+		return MMTAG_UNKNOWN;
+	return _apetag_int[i - 1];
+}
 
 typedef struct apetagread {
 	ffuint state;
@@ -150,8 +160,7 @@ static int _apetagr_field_read(struct apetagread *a, ffstr *data, ffstr *name, f
 	ffstr_set(value, data->ptr + r+1, val_len);
 	ffstr_shift(data, r+1 + val_len);
 
-	r = ffszarr_ifindsorted(_apetag_str, FF_COUNT(_apetag_str), name->ptr, name->len);
-	return (r >= 0) ? -(int)_apetag_int[r] : MMTAG_UNKNOWN;
+	return -apetag_find(name->ptr, name->len);
 }
 
 /**
@@ -1,6 +1,4 @@
 /** avpack: .avi reader
-* no seeking
-
 2016,2021, Simon Zolin
 */
 
@@ -8,6 +6,7 @@
 aviread_open
 aviread_close
 aviread_process
+aviread_seek
 aviread_error
 aviread_track_info
 aviread_track_activate
@@ -21,7 +20,15 @@ aviread_offset
 #include <ffbase/vector.h>
 
 struct aviread_seekpt {
-	ffuint off;
+	ffuint64 off; // chunk header offset
+	ffuint64 sample; // audio position at the beginning of chunk
+};
+
+/** OpenDML standard index chunk */
+struct _aviread_ixref {
+	ffuint track;
+	ffuint size;
+	ffuint64 off;
 };
 
 typedef void (*avi_log_t)(void *udata, const char *fmt, va_list va);
@@ -52,12 +59,26 @@ typedef struct aviread {
 
 	ffuint movi_off;
 	ffuint movi_size;
+	ffuint64 total_size;
+
+	// seeking
+	struct aviread_chunk movi_chunks[5]; // chunk stack at the beginning of "movi"
+	ffuint movi_ictx;
+	ffvec index; // struct aviread_seekpt[]
+	ffvec ixrefs; // struct _aviread_ixref[]
+	ffuint64 index_pos;
+	ffuint64 idx1_base;
+	ffuint idx1_n;
+	ffuint ix_i;
+	ffuint64 seek_sample; // -1: none
 
 	int tag; //enum FFMMTAG or -1
 	ffstr tagval;
 
 	ffuint has_fmt :1
 		, codec_conf_pending :1
+		, index_loaded :1
+		, idx1_first :1
 		;
 
 	avi_log_t log;
@@ -68,11 +89,13 @@ static inline void aviread_open(aviread *a)
 {
 	a->chunks[0].ctx = avi_ctx_global;
 	a->chunks[0].size = (ffuint)-1;
+	a->seek_sample = ~0ULL;
 }
 
 static inline void aviread_open2(aviread *a, struct avpk_reader_conf *conf)
 {
 	aviread_open(a);
+	a->total_size = conf->total_size;
 	a->log = conf->log;
 	a->udata = conf->opaque;
 }
@@ -85,6 +108,8 @@ static inline void aviread_close(aviread *a)
 		ffstr_free(&t->codec_conf);
 	}
 	ffvec_free(&a->tracks);
+	ffvec_free(&a->index);
+	ffvec_free(&a->ixrefs);
 }
 
 #define aviread_cursample(a)  ((a)->nsamples - (a)->curtrack->blocksize)
@@ -108,6 +133,8 @@ static inline void aviread_track_activate(aviread *a, int index)
 {
 	struct avi_audio_info *t = (struct avi_audio_info*)a->tracks.ptr;
 	a->curtrack = &t[index];
+	if (a->curtrack->codec != AVPKC_PCM && a->curtrack->blocksize == 0)
+		a->curtrack->blocksize = a->curtrack->scale; // VBR audio: 1 chunk = 'scale' samples
 }
 
 /** Get tag info */
@@ -123,6 +150,7 @@ enum AVIREAD_R {
 	AVIREAD_DATA = AVPK_DATA,
 	AVIREAD_MORE = AVPK_MORE,
 	AVIREAD_HEADER = AVPK_HEADER,
+	AVIREAD_SEEK = AVPK_SEEK,
 	AVIREAD_DONE = AVPK_FIN,
 	AVIREAD_TAG = AVPK_META,
 	AVIREAD_ERROR = AVPK_ERROR,
@@ -160,6 +188,64 @@ static inline void _aviread_log(aviread *a, const char *fmt, ...)
 	va_end(va);
 }
 
+/** Get the number of audio samples in data chunk */
+static ffuint _aviread_chunk_samples(const struct avi_audio_info *ai, ffuint size)
+{
+	if (ai->codec == AVPKC_PCM) {
+		ffuint frame = ai->bits/8 * ai->channels;
+		return (frame != 0) ? size / frame : 0;
+	}
+	return ai->blocksize;
+}
+
+static int _aviread_index_add(aviread *a, ffuint64 off, ffuint size)
+{
+	if (size == 0)
+		return 0;
+	struct aviread_seekpt *sp = ffvec_pushT(&a->index, struct aviread_seekpt);
+	if (sp == NULL)
+		return -1;
+	sp->off = off;
+	sp->sample = a->index_pos;
+	a->index_pos += _aviread_chunk_samples(a->curtrack, size);
+	return 0;
+}
+
+/** Find the last chunk starting before or at 'sample' */
+static const struct aviread_seekpt* _aviread_index_find(aviread *a, ffuint64 sample)
+{
+	const struct aviread_seekpt *sp = (struct aviread_seekpt*)a->index.ptr;
+	ffsize lo = 0, hi = a->index.len;
+	if (hi == 0)
+		return NULL;
+	while (hi - lo > 1) {
+		ffsize m = lo + (hi - lo) / 2;
+		if (sp[m].sample <= sample)
+			lo = m;
+		else
+			hi = m;
+	}
+	return &sp[lo];
+}
+
+/** Continue reading "movi" chunk at 'off' */
+static void _aviread_movi_enter(aviread *a, ffuint64 off)
+{
+	ffmem_copy(a->chunks, a->movi_chunks, sizeof(a->chunks));
+	a->ictx = a->movi_ictx;
+	ffuint64 end = (ffuint64)a->movi_off + a->movi_size;
+	ffuint size;
+	if (off <= end)
+		size = end - off;
+	else if (a->total_size > off)
+		size = ffmin64(a->total_size - off, 0x7fffffff); // OpenDML: "movi" in RIFF-AVIX
+	else
+		size = 0x7fffffff;
+	a->chunks[a->ictx].size = size;
+	a->off = off;
+	a->buf.len = 0;
+}
+
 static void _aviread_chunkinfo(aviread *a, const void *data, const struct avi_binchunk *ctx, struct aviread_chunk *chunk, ffuint64 off)
 {
 	const struct avi_chunk *ch = data;
@@ -222,12 +308,30 @@ static int _aviread_chunk(aviread *a)
 		}
 		break;
 
+	case AVI_T_INDX: {
+		if (a->tracks.len == 0)
+			break;
+		ffuint64 off;
+		ffuint size;
+		for (ffuint i = 0;  avi_indx_read(&a->gbuf, i, &off, &size);  i++) {
+			struct _aviread_ixref *ix = ffvec_pushT(&a->ixrefs, struct _aviread_ixref);
+			if (ix == NULL)
+				return _AVIR_ERR(a, AVI_EMEM);
+			ix->track = a->tracks.len - 1;
+			ix->size = size;
+			ix->off = off;
+		}
+		break;
+	}
+
 	case AVI_T_INFO:
 		break;
 
 	case AVI_T_MOVI:
 		a->movi_off = a->off;
 		a->movi_size = chunk->size;
+		ffmem_copy(a->movi_chunks, a->chunks, sizeof(a->chunks));
+		a->movi_ictx = a->ictx;
 		return AVIREAD_HEADER;
 
 	case AVI_T_MOVI_CHUNK: {
@@ -271,6 +375,11 @@ Return enum AVIREAD_R */
 . Search chunk ID in the current context; skip chunk if unknown
 . If it's a LIST chunk, gather its sub-ID; repeat the previous step
 . Process chunk
+
+Seeking:
+. Seek to OpenDML standard index chunks ("ix##") of the active track or to "idx1" chunk after "movi"
+. Build the table of chunk offsets and audio positions
+. Binary search the target chunk; seek to it
 */
 static inline int aviread_process(aviread *a, ffstr *input, ffstr *output)
 {
@@ -279,6 +388,9 @@ static inline int aviread_process(aviread *a, ffstr *input, ffstr *output)
 		R_NEXTCHUNK, R_SKIP, R_PADDING,
 		R_DATA,
 		R_GATHER,
+		R_SEEK = 10, R_SEEK_DONE,
+		R_IX_NEXT, R_IX,
+		R_IDX1_SEEK, R_IDX1_HDR, R_IDX1_NEXT, R_IDX1_ENT,
 	};
 	int r;
 	struct aviread_chunk *chunk, *parent;
@@ -418,10 +530,135 @@ static inline int aviread_process(aviread *a, ffstr *input, ffstr *output)
 			continue;
 
 		case R_DATA:
-			ffstr_set(output, a->gbuf.ptr, a->gbuf.len);
 			a->state = R_NEXTCHUNK;
 			a->nsamples += a->curtrack->blocksize;
+			if (a->seek_sample != ~0ULL) {
+				if (a->nsamples <= a->seek_sample && a->curtrack->blocksize != 0)
+					continue; // skip chunks before the target
+				a->seek_sample = ~0ULL;
+			}
+			ffstr_set(output, a->gbuf.ptr, a->gbuf.len);
 			return AVIREAD_DATA;
+
+		case R_SEEK: {
+			if (a->index_loaded) {
+				a->state = R_SEEK_DONE;
+				continue;
+			}
+			a->index.len = 0;
+			a->index_pos = 0;
+			a->ix_i = 0;
+			a->state = R_IDX1_SEEK;
+			struct _aviread_ixref *ix;
+			FFSLICE_WALK(&a->ixrefs, ix) {
+				if (ix->track == (ffuint)(a->curtrack - (struct avi_audio_info*)a->tracks.ptr)) {
+					a->state = R_IX_NEXT;
+					break;
+				}
+			}
+			continue;
+		}
+
+		case R_IX_NEXT: {
+			ffuint itrack = a->curtrack - (struct avi_audio_info*)a->tracks.ptr;
+			const struct _aviread_ixref *ix = (struct _aviread_ixref*)a->ixrefs.ptr;
+			while (a->ix_i != a->ixrefs.len && ix[a->ix_i].track != itrack) {
+				a->ix_i++;
+			}
+			if (a->ix_i == a->ixrefs.len) {
+				a->index_loaded = 1;
+				a->state = R_SEEK_DONE;
+				continue;
+			}
+			ix = &ix[a->ix_i];
+			if (ix->size < sizeof(struct avi_chunk) + sizeof(struct avi_ix)) {
+				a->ix_i++;
+				continue;
+			}
+			a->off = ix->off;
+			a->buf.len = 0;
+			a->gather_size = ix->size;
+			a->state = R_GATHER,  a->nxstate = R_IX;
+			return AVIREAD_SEEK;
+		}
+
+		case R_IX: {
+			ffuint64 off;
+			ffuint size;
+			ffstr d = a->gbuf;
+			ffstr_shift(&d, sizeof(struct avi_chunk));
+			for (ffuint i = 0;  avi_ix_read(&d, i, &off, &size);  i++) {
+				if (0 != _aviread_index_add(a, off, size))
+					return _AVIR_ERR(a, AVI_EMEM);
+			}
+			a->ix_i++;
+			a->state = R_IX_NEXT;
+			continue;
+		}
+
+		case R_IDX1_SEEK:
+			a->off = (ffuint64)a->movi_off + a->movi_size + (a->movi_size & 1);
+			a->buf.len = 0;
+			a->gather_size = sizeof(struct avi_chunk);
+			a->state = R_GATHER,  a->nxstate = R_IDX1_HDR;
+			return AVIREAD_SEEK;
+
+		case R_IDX1_HDR: {
+			const struct avi_chunk *ch = (struct avi_chunk*)a->gbuf.ptr;
+			a->index_loaded = 1;
+			a->state = R_SEEK_DONE;
+			if (!!ffmem_cmp(ch->id, "idx1", 4))
+				continue;
+			a->idx1_n = ffint_le_cpu32_ptr(ch->size) / sizeof(struct avi_idx1_entry);
+			a->idx1_first = 1;
+			a->state = R_IDX1_NEXT;
+		}
+			// fallthrough
+
+		case R_IDX1_NEXT:
+			if (a->idx1_n == 0) {
+				a->state = R_SEEK_DONE;
+				continue;
+			}
+			a->idx1_n--;
+			a->gather_size = sizeof(struct avi_idx1_entry);
+			a->state = R_GATHER,  a->nxstate = R_IDX1_ENT;
+			continue;
+
+		case R_IDX1_ENT: {
+			const struct avi_idx1_entry *e = (struct avi_idx1_entry*)a->gbuf.ptr;
+			ffuint off = ffint_le_cpu32_ptr(e->offset);
+			if (a->idx1_first) {
+				// offsets are either relative to "movi" ID or absolute
+				a->idx1_first = 0;
+				a->idx1_base = (off >= a->movi_off) ? 0 : a->movi_off - 4;
+			}
+
+			ffuint idx;
+			a->state = R_IDX1_NEXT;
+			if (2 != ffs_toint(e->id, 2, &idx, FFS_INT32)
+				|| (int)idx != a->curtrack - (struct avi_audio_info*)a->tracks.ptr
+				|| !!ffmem_cmp(e->id + 2, AVI_MOVI_AUDIO, 2))
+				continue;
+
+			if (0 != _aviread_index_add(a, a->idx1_base + off, ffint_le_cpu32_ptr(e->size)))
+				return _AVIR_ERR(a, AVI_EMEM);
+			continue;
+		}
+
+		case R_SEEK_DONE: {
+			const struct aviread_seekpt *sp = _aviread_index_find(a, a->seek_sample);
+			if (sp != NULL) {
+				_aviread_movi_enter(a, sp->off);
+				a->nsamples = sp->sample;
+			} else {
+				// no index: read from the beginning and skip chunks
+				_aviread_movi_enter(a, a->movi_off);
+				a->nsamples = 0;
+			}
+			a->state = R_NEXTCHUNK;
+			return AVIREAD_SEEK;
+		}
 		}
 	}
 }
@@ -467,6 +704,10 @@ static inline int aviread_process2(aviread *a, ffstr *input, union avpk_read_res
 		res->tag.value = a->tagval;
 		break;
 
+	case AVPK_SEEK:
+		res->seek_offset = a->off;
+		break;
+
 	case AVPK_DATA:
 		res->frame.pos = a->nsamples - a->curtrack->blocksize;
 		res->frame.end_pos = ~0ULL;
@@ -482,6 +723,16 @@ static inline int aviread_process2(aviread *a, ffstr *input, union avpk_read_res
 	return r;
 }
 
+/** Seek to the chunk containing 'sample'.
+The index is read on the first call. */
+static inline void aviread_seek(aviread *a, ffuint64 sample)
+{
+	if (a->movi_off == 0 || a->curtrack == NULL)
+		return;
+	a->seek_sample = sample;
+	a->state = 10; // R_SEEK
+}
+
 #undef _AVIR_ERR
 
-AVPKR_IF_INIT(avpk_avi, "avi", AVPKF_AVI, aviread, aviread_open2, aviread_process2, NULL, aviread_close);
+AVPKR_IF_INIT(avpk_avi, "avi", AVPKF_AVI, aviread, aviread_open2, aviread_process2, aviread_seek, aviread_close);
@@ -6,10 +6,13 @@
 avi_strh_read
 avi_strf_read
 avi_chunk_find
+avi_indx_read
+avi_ix_read
 */
 
 /* .avi format:
-AVI (hdrl(strl...) INFO(xxxx...) movi(xxxx(DATA...)...) idx1(xxxx()...))
+AVI (hdrl(strl(strh strf [indx])...) INFO(xxxx...) movi(xxxx(DATA...)... [ix##]...) [idx1(ENTRY...)])
+[AVIX (movi(xxxx(DATA...)... [ix##]...))]...
 */
 
 #pragma once
@@ -137,6 +140,91 @@ static int avi_strf_read(struct avi_audio_info *ai, const char *data, ffsize len
 	return 0;
 }
 
+/** Legacy index entry */
+struct avi_idx1_entry {
+	char id[4]; // "NNwb"
+	ffbyte flags[4];
+	ffbyte offset[4]; // chunk header offset: relative to "movi" or absolute
+	ffbyte size[4];
+};
+
+enum AVI_INDEX_TYPE {
+	AVI_INDEX_OF_INDEXES = 0,
+	AVI_INDEX_OF_CHUNKS = 1,
+};
+
+/** OpenDML super index ("indx" chunk) */
+struct avi_indx {
+	ffbyte longs_per_entry[2]; // 4
+	ffbyte sub_type;
+	ffbyte type; // enum AVI_INDEX_TYPE
+	ffbyte entries[4];
+	char chunk_id[4];
+	ffbyte reserved[12];
+	// struct avi_indx_entry[]
+};
+
+struct avi_indx_entry {
+	ffbyte offset[8]; // ix## chunk header offset
+	ffbyte size[4]; // ix## chunk size (with header)
+	ffbyte duration[4];
+};
+
+/** OpenDML standard index ("ix##" chunk) */
+struct avi_ix {
+	ffbyte longs_per_entry[2]; // 2
+	ffbyte sub_type;
+	ffbyte type; // enum AVI_INDEX_TYPE
+	ffbyte entries[4];
+	char chunk_id[4];
+	ffbyte base_offset[8];
+	ffbyte reserved[4];
+	// struct avi_ix_entry[]
+};
+
+struct avi_ix_entry {
+	ffbyte offset[4]; // chunk data offset relative to base_offset
+	ffbyte size[4]; // [1]: not a key frame;  [31]: size
+};
+
+/** Get next entry from super index chunk body
+Return 1: 'off' and 'size' are set;
+ 0: no more entries */
+static inline int avi_indx_read(ffstr *data, ffuint i, ffuint64 *off, ffuint *size)
+{
+	const struct avi_indx *h = (struct avi_indx*)data->ptr;
+	if (data->len < sizeof(struct avi_indx)
+		|| ffint_le_cpu16_ptr(h->longs_per_entry) != 4
+		|| h->type != AVI_INDEX_OF_INDEXES
+		|| i >= ffint_le_cpu32_ptr(h->entries)
+		|| sizeof(struct avi_indx) + (i + 1) * sizeof(struct avi_indx_entry) > data->len)
+		return 0;
+
+	const struct avi_indx_entry *e = (struct avi_indx_entry*)(data->ptr + sizeof(struct avi_indx));
+	*off = ffint_le_cpu64_ptr(e[i].offset);
+	*size = ffint_le_cpu32_ptr(e[i].size);
+	return 1;
+}
+
+/** Get next entry from standard index chunk body
+Return 1: 'off' (chunk header offset) and 'size' are set;
+ 0: no more entries */
+static inline int avi_ix_read(ffstr *data, ffuint i, ffuint64 *off, ffuint *size)
+{
+	const struct avi_ix *h = (struct avi_ix*)data->ptr;
+	if (data->len < sizeof(struct avi_ix)
+		|| ffint_le_cpu16_ptr(h->longs_per_entry) != 2
+		|| h->type != AVI_INDEX_OF_CHUNKS
+		|| i >= ffint_le_cpu32_ptr(h->entries)
+		|| sizeof(struct avi_ix) + (i + 1) * sizeof(struct avi_ix_entry) > data->len)
+		return 0;
+
+	const struct avi_ix_entry *e = (struct avi_ix_entry*)(data->ptr + sizeof(struct avi_ix));
+	*off = ffint_le_cpu64_ptr(h->base_offset) + ffint_le_cpu32_ptr(e[i].offset) - sizeof(struct avi_chunk);
+	*size = ffint_le_cpu32_ptr(e[i].size) & 0x7fffffff;
+	return 1;
+}
+
 enum {
 	AVI_MASK_CHUNKID = 0x000000ff,
 };
@@ -150,6 +238,7 @@ enum {
 	AVI_T_INFO,
 	AVI_T_MOVI,
 	AVI_T_MOVI_CHUNK,
+	AVI_T_INDX,
 
 	_AVI_T_TAG,
 };
@@ -196,6 +285,7 @@ RIFF "AVI "
   LIST strl
    strh
    strf
+   indx
  LIST INFO
   *
  LIST movi
@@ -234,6 +324,7 @@ static const struct avi_binchunk avi_ctx_hdrl_list[] = {
 	{ "strl", AVI_T_ANY | AVI_F_LAST, avi_ctx_strl },
 };
 static const struct avi_binchunk avi_ctx_strl[] = {
+	{ "indx", AVI_T_INDX | AVI_F_WHOLE | AVI_MINSIZE(sizeof(struct avi_indx)), NULL },
 	{ "strh", AVI_T_STRH | AVI_MINSIZE(sizeof(struct avi_strh)), NULL },
 	{ "strf", AVI_T_STRF | AVI_F_WHOLE | AVI_MINSIZE(sizeof(struct avi_strf_audio)) | AVI_F_LAST, NULL },
 };
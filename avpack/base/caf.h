@@ -3,11 +3,12 @@
 */
 
 /*
-caf_hdr_read
-caf_pakt_read
-caf_desc_read
-caf_varint
-caf_mp4_esds_read
+caf_hdr_read caf_hdr_write
+caf_chunk_write
+caf_pakt_read caf_pakt_write
+caf_desc_read caf_desc_write
+caf_varint caf_varint_write
+caf_mp4_esds_read caf_mp4_esds_write
 kuki_alac_read
 */
 
@@ -52,11 +53,25 @@ static inline int caf_hdr_read(const void *data)
 	return 0;
 }
 
+static inline int caf_hdr_write(void *dst)
+{
+	ffmem_copy(dst, "caff\x00\x01\x00\x00", sizeof(struct caf_hdr));
+	return sizeof(struct caf_hdr);
+}
+
 struct caf_chunk {
 	char type[4];
 	ffbyte size[8]; // may be -1 for Audio Data chunk
 };
 
+static inline int caf_chunk_write(void *dst, const char *type, ffuint64 size)
+{
+	struct caf_chunk *c = (struct caf_chunk*)dst;
+	ffmem_copy(c->type, type, 4);
+	*(ffuint64*)c->size = ffint_be_cpu64(size);
+	return sizeof(struct caf_chunk);
+}
+
 struct _caf_info {
 	// "info"
 	ffbyte entries[4];
@@ -80,6 +95,17 @@ static inline int caf_pakt_read(caf_info *info, const void *data)
 	return sizeof(struct caf_pakt);
 }
 
+/** Write "pakt" chunk body header; the packet sizes follow it */
+static inline int caf_pakt_write(void *dst, ffuint64 packets, ffuint64 frames, ffuint priming, ffuint remainder)
+{
+	struct caf_pakt *p = (struct caf_pakt*)dst;
+	*(ffuint64*)p->npackets = ffint_be_cpu64(packets);
+	*(ffuint64*)p->nframes = ffint_be_cpu64(frames);
+	*(ffuint*)p->latency_frames = ffint_be_cpu32(priming);
+	*(ffuint*)p->remainder_frames = ffint_be_cpu32(remainder);
+	return sizeof(struct caf_pakt);
+}
+
 struct caf_desc {
 	// "desc"
 	ffbyte srate[8]; // float64
@@ -121,11 +147,58 @@ static inline int caf_desc_read(caf_info *info, const void *data)
 	return 0;
 }
 
+/**
+info.format: ALAC: bits per sample */
+static inline int caf_desc_write(void *data, const caf_info *info)
+{
+	struct caf_desc *d = (struct caf_desc*)data;
+	double sr = info->sample_rate;
+	ffuint64 i;
+	ffmem_copy(&i, &sr, 8);
+	*(ffuint64*)d->srate = ffint_be_cpu64(i);
+
+	ffuint flags = 0, bits = 0;
+	switch (info->codec) {
+	case AVPKC_AAC:
+		ffmem_copy(d->fmt, "aac ", 4);  break;
+
+	case AVPKC_ALAC:
+		ffmem_copy(d->fmt, "alac", 4);
+		// format flags contain the source bit depth
+		switch (info->format & 0xff) {
+		case 16:
+			flags = 1;  break;
+		case 20:
+			flags = 2;  break;
+		case 24:
+			flags = 3;  break;
+		case 32:
+			flags = 4;  break;
+		}
+		break;
+
+	default:
+		ffmem_copy(d->fmt, "lpcm", 4);
+		bits = info->format & 0xff;
+		flags = 2; // little-endian
+		if (info->format & CAF_FMT_FLOAT)
+			flags |= 1;
+	}
+
+	*(ffuint*)d->flags = ffint_be_cpu32(flags);
+	*(ffuint*)d->pkt_size = ffint_be_cpu32(info->packet_bytes);
+	*(ffuint*)d->pkt_frames = ffint_be_cpu32(info->packet_frames);
+	*(ffuint*)d->channels = ffint_be_cpu32(info->channels);
+	*(ffuint*)d->bits = ffint_be_cpu32(bits);
+	return sizeof(struct caf_desc);
+}
+
 /** Read integer.
 
 Format:
 0xxxxxxx
 1xxxxxxx 0xxxxxxx
+1xxxxxxx 1xxxxxxx ... 0xxxxxxx
 
 Return N of bytes read;
  0 if done;
@@ -136,21 +209,37 @@ static inline int caf_varint(const void *data, ffsize len, ffuint *dst)
 	if (len == 0)
 		return 0;
 
-	ffuint d0 = d[0];
-	if (d0 & 0x80) {
-		if (len < 2)
-			return -1;
-
-		if (d[1] & 0x80)
+	ffuint n = 0;
+	for (ffuint i = 0;  i != 4;  i++) {
+		if (i == len)
 			return -1;
+		n = (n << 7) | (d[i] & 0x7f);
+		if (!(d[i] & 0x80)) {
+			*dst = n;
+			return i + 1;
+		}
+	}
+	return -1;
+}
 
-		*dst = (d0 & 0x7f) << 7;
-		*dst |= d[1];
-		return 2;
+/** Write integer.
+dst: NULL: return the size only
+Return N of bytes written */
+static inline int caf_varint_write(void *dst, ffuint n)
+{
+	ffuint len = 1;
+	for (ffuint i = n >> 7;  i != 0;  i >>= 7) {
+		len++;
 	}
+	if (dst == NULL)
+		return len;
 
-	*dst = d0;
-	return 1;
+	ffbyte *d = (ffbyte*)dst;
+	for (ffuint i = len;  i != 0;  i--) {
+		d[i - 1] = (n & 0x7f) | ((i != len) ? 0x80 : 0);
+		n >>= 7;
+	}
+	return len;
 }
 
 
@@ -179,7 +268,7 @@ enum CAF_MP4_ESDS_TAGS {
 };
 struct caf_mp4_esds_tag {
 	ffbyte tag; //enum CAF_MP4_ESDS_TAGS
-	ffbyte size[4]; //"NN" | "80 80 80 NN"
+	ffbyte size[4]; //"NN" | 7 bits per byte, high bit: more bytes follow: "8N 8N 8N NN"
 };
 struct caf_mp4_esds {
 	ffbyte unused[3];
@@ -209,16 +298,19 @@ static int caf_mp4_esds_block(const char **pd, const char *end, ffuint *size)
 	if (*pd + 2 > end)
 		return 0;
 
-	if (tag->size[0] != 0x80) {
-		*pd += 2;
-		sz = tag->size[0];
-
-	} else {
-		*pd += sizeof(struct caf_mp4_esds_tag);
-		if (*pd > end)
+	ffuint i = 0;
+	sz = 0;
+	for (;;) {
+		if (*pd + 1 + i + 1 > end)
+			return 0;
+		ffuint b = tag->size[i++];
+		sz = (sz << 7) | (b & 0x7f);
+		if (!(b & 0x80))
+			break;
+		if (i == sizeof(tag->size))
 			return 0;
-		sz = tag->size[3];
 	}
+	*pd += 1 + i;
 
 	if (sz < *size)
 		return 0;
@@ -250,7 +342,8 @@ static inline int caf_mp4_esds_read(const char *data, ffuint len, struct caf_mp4
 			ac->avg_brate = ffint_be_cpu32_ptr(dec->avg_brate);
 
 			size = sizeof(struct caf_mp4_esds_decspec);
-			if (CAF_MP4_ESDS_DECSPEC_TAG == caf_mp4_esds_block(&d, end, &size)) {
+			if (CAF_MP4_ESDS_DECSPEC_TAG == caf_mp4_esds_block(&d, end, &size)
+				&& size <= (ffsize)(end - d)) {
 				const struct caf_mp4_esds_decspec *spec = (struct caf_mp4_esds_decspec*)d;
 				d += size;
 				ac->conf = (char*)spec->data,  ac->conflen = size;
@@ -262,7 +355,62 @@ static inline int caf_mp4_esds_read(const char *data, ffuint len, struct caf_mp4
 	return r;
 }
 
-/*
+static ffuint caf_mp4_esds_block_write(char *dst, ffuint tag, ffuint size)
+{
+	struct caf_mp4_esds_tag *t = (struct caf_mp4_esds_tag*)dst;
+	t->tag = tag;
+	t->size[0] = 0x80 | ((size >> 21) & 0x7f);
+	t->size[1] = 0x80 | ((size >> 14) & 0x7f);
+	t->size[2] = 0x80 | ((size >> 7) & 0x7f);
+	t->size[3] = size & 0x7f;
+	return sizeof(struct caf_mp4_esds_tag);
+}
+
+enum {
+	CAF_MP4_ESDS_CONF_MAX = 0x0fffff00, // max size of codec config: descriptor size is 28-bit
+};
+
+/**
+dst: NULL: return the size only
+Return 0 if the codec config is too large */
+static inline int caf_mp4_esds_write(char *dst, const struct caf_mp4_acodec *ac)
+{
+	ffuint total = sizeof(struct caf_mp4_esds)
+		+ sizeof(struct caf_mp4_esds_tag) + sizeof(struct caf_mp4_esds_dec)
+		+ sizeof(struct caf_mp4_esds_tag) + ac->conflen
+		+ sizeof(struct caf_mp4_esds_tag) + sizeof(struct caf_mp4_esds_sl);
+	if (ac->conflen > CAF_MP4_ESDS_CONF_MAX)
+		return 0;
+	if (dst == NULL)
+		return sizeof(struct caf_mp4_esds_tag) + total;
+
+	char *d = dst;
+	d += caf_mp4_esds_block_write(d, CAF_MP4_ESDS_TAG, total);
+	ffmem_zero(d, sizeof(struct caf_mp4_esds));
+	d += sizeof(struct caf_mp4_esds);
+
+	d += caf_mp4_esds_block_write(d, CAF_MP4_ESDS_DEC_TAG, sizeof(struct caf_mp4_esds_dec) + sizeof(struct caf_mp4_esds_tag) + ac->conflen);
+	struct caf_mp4_esds_dec *dec = (struct caf_mp4_esds_dec*)d;
+	dec->type = ac->type;
+	dec->stm_type = ac->stm_type;
+	ffmem_zero(dec->unused, sizeof(dec->unused));
+	*(ffuint*)dec->max_brate = ffint_be_cpu32(ac->max_brate);
+	*(ffuint*)dec->avg_brate = ffint_be_cpu32(ac->avg_brate);
+	d += sizeof(struct caf_mp4_esds_dec);
+
+	d += caf_mp4_esds_block_write(d, CAF_MP4_ESDS_DECSPEC_TAG, ac->conflen);
+	d = (char*)ffmem_copy(d, ac->conf, ac->conflen);
+
+	d += caf_mp4_esds_block_write(d, CAF_MP4_ESDS_SL_TAG, sizeof(struct caf_mp4_esds_sl));
+	struct caf_mp4_esds_sl *sl = (struct caf_mp4_esds_sl*)d;
+	sl->val = 0x02;
+	d += sizeof(struct caf_mp4_esds_sl);
+
+	return d - dst;
+}
+
+/* Either ALACSpecificConfig[24] or:
+
 len[4] // =12
 [8] "frmaalac"
 
@@ -274,9 +422,16 @@ conf[24]
 */
 static inline int kuki_alac_read(ffstr in, ffstr *out)
 {
-	if (12+12+24 > in.len || !!ffmem_cmp(in.ptr+4, "frmaalac", 8))
+	if (in.len >= 12 && !ffmem_cmp(in.ptr+4, "frmaalac", 8)) {
+		if (12+12+24 > in.len)
+			return -1;
+		ffstr_set(out, in.ptr + 12+12, 24);
+		return 0;
+	}
+
+	if (24 > in.len)
 		return -1;
-	ffstr_set(out, in.ptr + 12+12, 24);
+	ffstr_set(out, in.ptr, 24);
 	return 0;
 }
 
@@ -14,7 +14,7 @@ flac_seektab_init
 flac_seektab_size
 flac_seektab_add
 flac_seektab_write
-flac_meta_pic
+flac_meta_pic flac_meta_pic_hdr
 flac_pic_write
 flac_frame_read
 flac_frame_find
@@ -398,36 +398,61 @@ ncolors[4]
 data_len[4]
 data[]
 */
-/** Parse picture block and return picture data
-Return 0 on success */
-static inline int flac_meta_pic(ffstr data, ffstr *pic)
+struct flac_pichdr {
+	ffuint type;
+	ffstr mime, desc;
+	ffuint width, height;
+	ffuint bpp;
+	ffuint data_off, data_len; // picture data position within block
+};
+
+/** Parse picture block header.
+Picture data itself needn't be present in 'data'.
+Return 0 on success;  -1: invalid or incomplete header */
+static inline int flac_meta_pic_hdr(ffstr data, struct flac_pichdr *h)
 {
 	ffuint i = 0;
 	const char *d = data.ptr;
 	if (8 > data.len)
 		return -1;
+	h->type = ffint_be_cpu32_ptr(&d[i]);
 	i += 4;
 
 	ffuint mime_len = ffint_be_cpu32_ptr(&d[i]);
-	i += 4 + mime_len;
-	if (i > data.len)
+	i += 4;
+	if (mime_len > data.len - i || 4 > data.len - i - mime_len)
 		return -1;
+	ffstr_set(&h->mime, &d[i], mime_len);
+	i += mime_len;
 
 	ffuint desc_len = ffint_be_cpu32_ptr(&d[i]);
-	i += 4 + desc_len;
-	i += 4*4;
-	if (i > data.len)
+	i += 4;
+	if (desc_len > data.len - i || 4*5 > data.len - i - desc_len)
 		return -1;
+	ffstr_set(&h->desc, &d[i], desc_len);
+	i += desc_len;
 
-	ffuint n = ffint_be_cpu32_ptr(&d[i]);
+	h->width = ffint_be_cpu32_ptr(&d[i]);
+	h->height = ffint_be_cpu32_ptr(&d[i + 4]);
+	h->bpp = ffint_be_cpu32_ptr(&d[i + 8]);
+	i += 4*4;
+
+	h->data_len = ffint_be_cpu32_ptr(&d[i]);
 	i += 4;
-	if (i + n > data.len)
-		return -1;
+	h->data_off = i;
+	return 0;
+}
 
-	// log("mime:%u  desc:%u  data:%u"
-		// , mime_len, desc_len, n);
+/** Parse picture block and return picture data
+Return 0 on success */
+static inline int flac_meta_pic(ffstr data, ffstr *pic)
+{
+	struct flac_pichdr h;
+	if (flac_meta_pic_hdr(data, &h)
+		|| h.data_len > data.len - h.data_off)
+		return -1;
 
-	ffstr_set(pic, &d[i], n);
+	ffstr_set(pic, &data.ptr[h.data_off], h.data_len);
 	return 0;
 }
 
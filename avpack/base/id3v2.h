@@ -5,6 +5,8 @@
 id3v2_hdr_read id3v2_hdr_write
 id3v2_frame_read id3v2_frame_write
 id3v2_data_decode
+id3v2_utf16_utf8
+id3v2_pic_read
 */
 
 /** ID3v2 format:
@@ -16,6 +18,12 @@ PADDING
 #pragma once
 #include <ffbase/string.h>
 
+#if defined __AVX2__
+	#include <immintrin.h>
+#elif defined __SSE2__
+	#include <emmintrin.h>
+#endif
+
 struct id3v2_taghdr {
 	char id3[3]; // "ID3"
 	ffbyte ver[2]; // e.g. \4\0 for v2.4
@@ -77,7 +85,40 @@ static inline ffuint _id3v2_int7_read(ffuint i)
 		| (i & 0x0000007f);
 }
 
-/** Replace: FF 00 -> FF */
+#if defined __SSE2__
+
+/** Copy data up to the first 0xff byte by 16-byte blocks (32 with AVX2).
+Bytes after 0xff within the last block are also written to 'dst'.
+Return the number of bytes copied (the position of 0xff, if found) */
+static inline ffsize _id3v2_unsync_copy(char *dst, const char *src, ffsize len)
+{
+	ffsize i = 0;
+	ffuint m;
+
+#if defined __AVX2__
+	const __m256i ff32 = _mm256_set1_epi8((char)0xff);
+	for (;  i + 32 <= len;  i += 32) {
+		__m256i v = _mm256_loadu_si256((__m256i*)(src + i));
+		_mm256_storeu_si256((__m256i*)(dst + i), v);
+		if ((m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, ff32))))
+			return i + ffbit_rfind32(m) - 1;
+	}
+#endif
+
+	const __m128i ff = _mm_set1_epi8((char)0xff);
+	for (;  i + 16 <= len;  i += 16) {
+		__m128i v = _mm_loadu_si128((__m128i*)(src + i));
+		_mm_storeu_si128((__m128i*)(dst + i), v);
+		if ((m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, ff))))
+			return i + ffbit_rfind32(m) - 1;
+	}
+	return i;
+}
+
+#endif // __SSE2__
+
+/** Replace: FF 00 -> FF
+'dst': buffer of at least 'in.len' bytes; must not overlap with the input data */
 static inline ffuint id3v2_data_decode(void *dst, ffstr in)
 {
 	char *p = dst;
@@ -92,6 +133,17 @@ static inline ffuint id3v2_data_decode(void *dst, ffstr in)
 				continue;
 		}
 
+#if defined __SSE2__
+		if (in.len - i >= 16) {
+			// output is never longer than input: writing a whole block at 'p' is safe
+			ffsize n = _id3v2_unsync_copy(p, in.ptr + i, in.len - i);
+			p += n;
+			i += n;
+			if (i == in.len)
+				break;
+		}
+#endif
+
 		if ((ffbyte)in.ptr[i] == 0xff) {
 			skip0 = 1;
 			continue;
@@ -102,6 +154,106 @@ static inline ffuint id3v2_data_decode(void *dst, ffstr in)
 	return p - (char*)dst;
 }
 
+#if defined __SSE2__
+
+/** Convert ASCII-only UTF-16 text by 8-character blocks (16 with AVX2).
+Stop at the first block containing a non-ASCII character.
+Return the number of characters converted */
+static inline ffsize _id3v2_utf16_ascii(char *dst, const char *src, ffsize n, ffuint be)
+{
+	ffsize i = 0;
+
+#if defined __AVX2__
+	const __m256i mask32 = _mm256_set1_epi16((short)0xff80);
+	for (;  i + 16 <= n;  i += 16) {
+		__m256i v = _mm256_loadu_si256((__m256i*)(src + i*2));
+		if (be)
+			v = _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8));
+		if (!_mm256_testz_si256(v, mask32))
+			break;
+		// packus works within 128-bit lanes: restore the order of 64-bit groups
+		v = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0xd8);
+		_mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(v));
+	}
+#endif
+
+	const __m128i mask = _mm_set1_epi16((short)0xff80);
+	const __m128i zero = _mm_setzero_si128();
+	for (;  i + 8 <= n;  i += 8) {
+		__m128i v = _mm_loadu_si128((__m128i*)(src + i*2));
+		if (be)
+			v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, mask), zero)) != 0xffff)
+			break;
+		_mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(v, v));
+	}
+	return i;
+}
+
+#endif // __SSE2__
+
+/** Convert UTF-16LE/BE text to UTF-8.
+'dst' must have space for 'len / 2 * 3' bytes.
+Unpaired surrogates are replaced with U+FFFD; the last odd byte is ignored.
+Return the number of bytes written */
+static inline ffsize id3v2_utf16_utf8(char *dst, const char *src, ffsize len, ffuint be)
+{
+	char *p = dst;
+	const ffbyte *s = (ffbyte*)src;
+	ffsize n = len / 2;
+
+	for (ffsize i = 0;  i < n;  ) {
+
+#if defined __SSE2__
+		if (n - i >= 8) {
+			ffsize k = _id3v2_utf16_ascii(p, (char*)s + i*2, n - i, be);
+			p += k;
+			i += k;
+			if (i == n)
+				break;
+		}
+#endif
+
+		// convert the characters of a non-ASCII block one by one
+		ffsize end = ffmin(i + 8, n);
+		while (i < end) {
+			ffuint c = (be) ? ffint_be_cpu16_ptr(s + i*2) : ffint_le_cpu16_ptr(s + i*2);
+			i++;
+
+			if (c < 0x80) {
+				*p++ = c;
+				continue;
+
+			} else if (c < 0x800) {
+				*p++ = 0xc0 | (c >> 6);
+				*p++ = 0x80 | (c & 0x3f);
+				continue;
+
+			} else if (c >= 0xd800 && c < 0xdc00 && i < n) {
+				ffuint c2 = (be) ? ffint_be_cpu16_ptr(s + i*2) : ffint_le_cpu16_ptr(s + i*2);
+				if (c2 >= 0xdc00 && c2 < 0xe000) {
+					i++;
+					c = 0x10000 + ((c - 0xd800) << 10) + (c2 - 0xdc00);
+					*p++ = 0xf0 | (c >> 18);
+					*p++ = 0x80 | ((c >> 12) & 0x3f);
+					*p++ = 0x80 | ((c >> 6) & 0x3f);
+					*p++ = 0x80 | (c & 0x3f);
+					continue;
+				}
+				c = 0xfffd;
+
+			} else if (c >= 0xd800 && c < 0xe000) {
+				c = 0xfffd;
+			}
+
+			*p++ = 0xe0 | (c >> 12);
+			*p++ = 0x80 | ((c >> 6) & 0x3f);
+			*p++ = 0x80 | (c & 0x3f);
+		}
+	}
+	return p - dst;
+}
+
 
 struct id3v2_hdr {
 	ffuint version;
@@ -225,6 +377,55 @@ static inline int id3v2_frame_read(struct id3v2_frame *f, ffstr data, ffuint ver
 	return i;
 }
 
+struct id3v2_pic {
+	ffstr mime; // v2.2: image format, e.g. "JPG"
+	ffuint type;
+	ffuint data_off; // picture data position within frame body
+};
+
+/** Parse APIC frame body (after text encoding byte) up to picture data:
+"MIME" \0 TYPE[1] "DESCRIPTION" \0 DATA[]
+v2.2 PIC: FORMAT[3] TYPE[1] "DESCRIPTION" \0 DATA[]
+Picture data itself needn't be present in 'body'.
+Return 0 on success;  -1: invalid or incomplete data */
+static inline int id3v2_pic_read(ffstr body, ffuint version, ffuint encoding, struct id3v2_pic *p)
+{
+	ffssize i;
+	if (version == 2) {
+		if (3 > body.len)
+			return -1;
+		ffstr_set(&p->mime, body.ptr, 3);
+		i = 3;
+	} else {
+		if ((i = ffs_findchar(body.ptr, body.len, '\0')) < 0)
+			return -1;
+		ffstr_set(&p->mime, body.ptr, i);
+		i++;
+	}
+
+	if ((ffsize)i == body.len)
+		return -1;
+	p->type = (ffbyte)body.ptr[i++];
+
+	if (encoding == ID3V2_UTF16BOM || encoding == ID3V2_UTF16BE) {
+		for (;;  i += 2) {
+			if ((ffsize)i + 2 > body.len)
+				return -1;
+			if (body.ptr[i] == '\0' && body.ptr[i + 1] == '\0')
+				break;
+		}
+		i += 2;
+	} else {
+		ffssize r = ffs_findchar(body.ptr + i, body.len - i, '\0');
+		if (r < 0)
+			return -1;
+		i += r + 1;
+	}
+
+	p->data_off = i;
+	return 0;
+}
+
 static inline ffuint id3v2_frame_write(void *dst, const char *id, int encoding, ffuint data_len)
 {
 	if (!dst)
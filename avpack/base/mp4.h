@@ -23,7 +23,7 @@ MAPS:
 	mp4_stco_size
 	mp4_stco_read mp4_stco_add
 META:
-	mp4_ilst_find
+	mp4_ilst_find mp4_ilst_box_find
 	mp4_ilst_data_read mp4_ilst_data_write
 	mp4_ilst_trkn_data_write
 	mp4_itunes_smpb_read mp4_itunes_smpb_write
@@ -112,7 +112,9 @@ enum BOX {
 	BOX_STSD_MP4A,
 	BOX_ALAC,
 	BOX_ESDS,
+	BOX_ILST,
 	BOX_ILST_DATA,
+	BOX_FREE,
 
 	BOX_ITUNES,
 	BOX_ITUNES_MEAN,
@@ -894,6 +896,12 @@ static inline int mp4_ilst_data_read(const char *data, ffuint len, ffuint parent
 		return MMTAG_DISCNUMBER;
 	}
 
+	case MMTAG_PICTURE:
+		if (!(d->type == MP4_ILST_JPEG || d->type == MP4_ILST_PNG || d->type == MP4_ILST_IMPLICIT))
+			return 0;
+		ffstr_set(tagval, data, len);
+		return MMTAG_PICTURE;
+
 	case BOX_TAG_GENRE_ID31: {
 		if (sizeof(short) > len || !(d->type == MP4_ILST_IMPLICIT || d->type == MP4_ILST_INT))
 			return 0;
@@ -1029,6 +1037,7 @@ moov
      mean
      name
      data
+   free(R)
 mdat
 */
 
@@ -1113,11 +1122,12 @@ static const struct mp4_bbox mp4_ctx_udta[] = {
 	{"meta", BOX_ANY | MP4_F_FULLBOX | MP4_F_LAST, mp4_ctx_meta},
 };
 static const struct mp4_bbox mp4_ctx_meta[] = {
-	{"ilst", BOX_ANY | MP4_F_LAST, mp4_ctx_ilst},
+	{"ilst", BOX_ILST, mp4_ctx_ilst},
+	{"free", BOX_FREE | MP4_F_MULTI | MP4_F_RO | MP4_F_LAST, NULL},
 };
 static const struct mp4_bbox mp4_ctx_ilst[] = {
 	{"aART",	_BOX_TAG + MMTAG_ALBUMARTIST,	mp4_ctx_data},
-	{"covr",	_BOX_TAG,	mp4_ctx_data},
+	{"covr",	_BOX_TAG + MMTAG_PICTURE,	mp4_ctx_data},
 	{"cprt",	_BOX_TAG + MMTAG_COPYRIGHT,	mp4_ctx_data},
 	{"desc",	_BOX_TAG,	mp4_ctx_data},
 	{"disk",	_BOX_TAG + MMTAG_DISCNUMBER,	mp4_ctx_data},
@@ -1136,6 +1146,16 @@ static const struct mp4_bbox mp4_ctx_ilst[] = {
 	{"----",	BOX_ITUNES | MP4_F_MULTI | MP4_F_LAST,	mp4_ctx_itunes},
 };
 
+/** Search "ilst" child box by type.
+Return index in mp4_ctx_ilst[];  -1: not found */
+static inline int mp4_ilst_box_find(const char type[4])
+{
+	ffuint i = _mp4_ilst_hash[_mmtag_hash_id(type, MP4_ILST_HASH_SEED, MP4_ILST_HASH_BITS)];
+	if (i == 0 || ffmem_cmp(type, mp4_ctx_ilst[i - 1].type, 4))
+		return -1;
+	return i - 1;
+}
+
 static const struct mp4_bbox mp4_ctx_data[] = {
 	{"data", BOX_ILST_DATA | MP4_F_WHOLE | MP4_MINSIZE(sizeof(struct mp4_ilst_data)) | MP4_F_LAST, NULL},
 };
@@ -13,6 +13,7 @@ mpeg1_find
 mpeg1_xing_read
 mpeg1_xing_seek
 mpeg1_xing_write
+mpeg1_xing_toc
 mpeg1_lame_read
 mpeg1_vbri_read
 */
@@ -293,7 +294,7 @@ static inline ffuint64 mpeg1_xing_seek(const ffbyte *toc, ffuint64 sample, ffuin
 }
 
 /** Write Xing tag
-Note: struct mpeg1_info.toc isn't supported
+struct mpeg1_info.toc is written if toc[99] != 0
 Return N of valid bytes */
 static inline int mpeg1_xing_write(const struct mpeg1_info *info, void *frame)
 {
@@ -322,6 +323,12 @@ static inline int mpeg1_xing_write(const struct mpeg1_info *info, void *frame)
 		flags |= MPEG1_XING_BYTES;
 	}
 
+	if (info->toc[99] != 0) {
+		ffmem_copy(&d[i], info->toc, 100);
+		i += 100;
+		flags |= MPEG1_XING_TOC;
+	}
+
 	if (info->vbr_scale != -1) {
 		*(ffuint*)&d[i] = ffint_be_cpu32(info->vbr_scale);
 		i += 4;
@@ -333,6 +340,28 @@ static inline int mpeg1_xing_write(const struct mpeg1_info *info, void *frame)
 }
 
 
+/** Fill Xing TOC from frame offsets
+offsets: offset of every 'interval'-th frame
+total_size: size of the stream (including Xing frame)
+header_size: size of Xing frame (offsets are relative to the first audio frame) */
+static inline void mpeg1_xing_toc(ffbyte *toc, const ffuint *offsets, ffuint n, ffuint interval, ffuint frames, ffuint64 total_size, ffuint header_size)
+{
+	if (n == 0 || total_size == 0)
+		return;
+
+	for (ffuint i = 0;  i < 100;  i++) {
+		ffuint64 fr = (ffuint64)i * frames / 100;
+		ffuint k = fr / interval;
+		ffuint64 off;
+		if (k + 1 < n)
+			off = offsets[k] + (ffuint64)(offsets[k + 1] - offsets[k]) * (fr - (ffuint64)k * interval) / interval;
+		else
+			off = offsets[n - 1];
+		toc[i] = ffmin((header_size + off) * 256 / total_size, 255);
+	}
+}
+
+
 struct mpeg1_lame {
 	char id[9]; //e.g. "LAME3.90a"
 	ffuint enc_delay;
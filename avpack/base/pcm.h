@@ -0,0 +1,182 @@
+/** avpack: PCM utilities
+2026, Simon Zolin
+*/
+
+/*
+pcm_deinterleave
+*/
+
+#pragma once
+#include <ffbase/base.h>
+
+#if defined __AVX2__
+	#include <immintrin.h>
+#elif defined __SSSE3__
+	#include <tmmintrin.h>
+#elif defined __SSE2__
+	#include <emmintrin.h>
+#endif
+
+#if defined __SSE2__
+
+/** 16-bit stereo: 8 frames per iteration (16 with AVX2)
+Return the number of frames processed */
+static inline ffsize _pcm_deint_16_2ch(void **dst, const void *src, ffsize samples)
+{
+	const char *s = (char*)src;
+	short *l = (short*)dst[0], *r = (short*)dst[1];
+	ffsize i = 0;
+
+#if defined __AVX2__
+	for (;  i + 16 <= samples;  i += 16) {
+		__m256i a = _mm256_loadu_si256((__m256i*)(s + i*4));
+		__m256i b = _mm256_loadu_si256((__m256i*)(s + i*4 + 32));
+		// sign-extend L and R into 32-bit words, then pack back to 16-bit
+		__m256i la = _mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16);
+		__m256i lb = _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16);
+		__m256i ra = _mm256_srai_epi32(a, 16);
+		__m256i rb = _mm256_srai_epi32(b, 16);
+		// packs works within 128-bit lanes: restore the order of 64-bit groups
+		__m256i lv = _mm256_permute4x64_epi64(_mm256_packs_epi32(la, lb), 0xd8);
+		__m256i rv = _mm256_permute4x64_epi64(_mm256_packs_epi32(ra, rb), 0xd8);
+		_mm256_storeu_si256((__m256i*)(l + i), lv);
+		_mm256_storeu_si256((__m256i*)(r + i), rv);
+	}
+#endif
+
+	for (;  i + 8 <= samples;  i += 8) {
+		__m128i a = _mm_loadu_si128((__m128i*)(s + i*4));
+		__m128i b = _mm_loadu_si128((__m128i*)(s + i*4 + 16));
+		__m128i la = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+		__m128i lb = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+		__m128i ra = _mm_srai_epi32(a, 16);
+		__m128i rb = _mm_srai_epi32(b, 16);
+		_mm_storeu_si128((__m128i*)(l + i), _mm_packs_epi32(la, lb));
+		_mm_storeu_si128((__m128i*)(r + i), _mm_packs_epi32(ra, rb));
+	}
+	return i;
+}
+
+/** 32-bit (integer or float) stereo: 4 frames per iteration (8 with AVX2)
+Return the number of frames processed */
+static inline ffsize _pcm_deint_32_2ch(void **dst, const void *src, ffsize samples)
+{
+	const char *s = (char*)src;
+	float *l = (float*)dst[0], *r = (float*)dst[1];
+	ffsize i = 0;
+
+#if defined __AVX2__
+	for (;  i + 8 <= samples;  i += 8) {
+		__m256 a = _mm256_loadu_ps((float*)(s + i*8));
+		__m256 b = _mm256_loadu_ps((float*)(s + i*8 + 32));
+		__m256 lv = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+		__m256 rv = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+		lv = _mm256_castsi256_ps(_mm256_permute4x64_epi64(_mm256_castps_si256(lv), 0xd8));
+		rv = _mm256_castsi256_ps(_mm256_permute4x64_epi64(_mm256_castps_si256(rv), 0xd8));
+		_mm256_storeu_ps(l + i, lv);
+		_mm256_storeu_ps(r + i, rv);
+	}
+#endif
+
+	for (;  i + 4 <= samples;  i += 4) {
+		__m128 a = _mm_loadu_ps((float*)(s + i*8));
+		__m128 b = _mm_loadu_ps((float*)(s + i*8 + 16));
+		_mm_storeu_ps(l + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0)));
+		_mm_storeu_ps(r + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1)));
+	}
+	return i;
+}
+
+#endif // __SSE2__
+
+#if defined __SSSE3__
+
+/** 24-bit stereo: 4 frames per iteration.
+Each of 2 loads holds 2 frames: byte shuffles gather L and R samples into 12-byte groups.
+16 bytes are stored per channel: the extra 4 bytes are overwritten by the next iteration,
+ so the loop stops while there's room for them.
+Return the number of frames processed */
+static inline ffsize _pcm_deint_24_2ch(void **dst, const void *src, ffsize samples)
+{
+	const char *s = (char*)src;
+	char *l = (char*)dst[0], *r = (char*)dst[1];
+	const __m128i la = _mm_setr_epi8(0,1,2, 6,7,8, -1,-1,-1, -1,-1,-1, -1,-1,-1,-1);
+	const __m128i lb = _mm_setr_epi8(-1,-1,-1, -1,-1,-1, 0,1,2, 6,7,8, -1,-1,-1,-1);
+	const __m128i ra = _mm_setr_epi8(3,4,5, 9,10,11, -1,-1,-1, -1,-1,-1, -1,-1,-1,-1);
+	const __m128i rb = _mm_setr_epi8(-1,-1,-1, -1,-1,-1, 3,4,5, 9,10,11, -1,-1,-1,-1);
+	ffsize i = 0;
+
+	for (;  i + 6 <= samples;  i += 4) {
+		__m128i a = _mm_loadu_si128((__m128i*)(s + i*6));
+		__m128i b = _mm_loadu_si128((__m128i*)(s + i*6 + 12));
+		__m128i lv = _mm_or_si128(_mm_shuffle_epi8(a, la), _mm_shuffle_epi8(b, lb));
+		__m128i rv = _mm_or_si128(_mm_shuffle_epi8(a, ra), _mm_shuffle_epi8(b, rb));
+		_mm_storeu_si128((__m128i*)(l + i*3), lv);
+		_mm_storeu_si128((__m128i*)(r + i*3), rv);
+	}
+	return i;
+}
+
+#endif // __SSSE3__
+
+/** Convert interleaved PCM samples to planar.
+Stereo 16/24/32-bit data uses SIMD kernels.
+Layouts with more channels use the scalar loop:
+ a byte-shuffle kernel for them needs a shuffle per overlapped input register
+ (up to 'channels + 2' per output register) and isn't faster than the plain copy.
+sample_size: bytes per sample of one channel (e.g. 2, 3, 4 or 8)
+dst: per-channel buffers of at least 'samples * sample_size' bytes */
+static inline void pcm_deinterleave(void **dst, const void *src, ffuint channels, ffuint sample_size, ffsize samples)
+{
+	ffsize i = 0;
+
+#if defined __SSE2__
+	if (channels == 2) {
+		switch (sample_size) {
+		case 2:
+			i = _pcm_deint_16_2ch(dst, src, samples);  break;
+		case 4:
+			i = _pcm_deint_32_2ch(dst, src, samples);  break;
+		}
+	}
+#endif
+
+#if defined __SSSE3__
+	if (channels == 2 && sample_size == 3)
+		i = _pcm_deint_24_2ch(dst, src, samples);
+#endif
+
+	if (i == samples)
+		return;
+
+	ffsize frame = channels * sample_size;
+	for (ffuint c = 0;  c != channels;  c++) {
+		const char *s = (char*)src + i * frame + c * sample_size;
+		char *d = (char*)dst[c] + i * sample_size;
+
+		switch (sample_size) {
+		case 2:
+			for (ffsize j = i;  j != samples;  j++, s += frame, d += 2) {
+				*(ffushort*)d = *(ffushort*)s;
+			}
+			break;
+
+		case 3:
+			for (ffsize j = i;  j != samples;  j++, s += frame, d += 3) {
+				d[0] = s[0];  d[1] = s[1];  d[2] = s[2];
+			}
+			break;
+
+		case 4:
+			for (ffsize j = i;  j != samples;  j++, s += frame, d += 4) {
+				*(ffuint*)d = *(ffuint*)s;
+			}
+			break;
+
+		default:
+			for (ffsize j = i;  j != samples;  j++, s += frame, d += sample_size) {
+				ffmem_copy(d, s, sample_size);
+			}
+		}
+	}
+}
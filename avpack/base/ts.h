@@ -16,7 +16,7 @@ PKT(PID:#DATA, DATA)...
 */
 
 #pragma once
-#include <ffbase/string.h>
+#include <ffbase/vector.h>
 
 struct ts_packet {
 	ffuint pid, counter;
@@ -43,7 +43,17 @@ struct _tsr_pm {
 	ffuint stream_type; // enum TS_STREAM
 	ffuint stream_id;
 	ffuint pkt_len;
+	ffuint64 pts; // 90kHz
 	ffuint64 pos_msec;
+
+	ffvec buf; // PES payload
+	ffuint pes_len; // PES payload bytes left to read;  0: until the next PES
+	ffuint pes_active :1;
+	ffuint pts_pending :1;
+
+	ffvec partial; // a frame which continues in the next PES
+	ffuint partial_out :1;
+	ffuint64 frame_base_msec, frame_samples;
 };
 
 static ffuint ts_read8(const ffbyte **d, const ffbyte *end)
@@ -188,6 +198,7 @@ static int ts_data_hdr_read(struct _tsr_pm *pm, ffstr data)
 	ffuint64 pos = ((ffuint64)(*d & 0x0e) << 29)
 		| ((ffint_be_cpu16_ptr(d + 1) & 0xfffe) << 14)
 		| (ffint_be_cpu16_ptr(d + 3) >> 1);
+	pm->pts = pos;
 	pm->pos_msec = pos / 90;
 	d += n;
 
@@ -4,6 +4,8 @@
 
 /*
 wav_chunk_write
+wav_ds64_read
+wav_ds64_write
 wav_fmt_read
 wav_fmt_write
 wav_bchunk_find
@@ -11,6 +13,7 @@ wav_bchunk_find
 
 /* .wav format:
 RIFF(fmt data(DATA...))
+RF64|BW64(ds64 fmt data(DATA...))
 */
 
 #pragma once
@@ -31,6 +34,41 @@ static inline int wav_chunk_write(void *dst, const char *id, ffuint size)
 	return 8;
 }
 
+/** RF64/BW64: 64-bit sizes.
+The 32-bit sizes of RIFF and data chunks are set to -1. */
+struct wav_ds64 {
+	ffbyte riff_size[8];
+	ffbyte data_size[8];
+	ffbyte sample_count[8];
+	ffbyte table_len[4]; // number of struct wav_ds64_table entries
+};
+
+/** Parse "ds64" chunk */
+static inline int wav_ds64_read(const void *data, ffsize len, ffuint64 *riff_size, ffuint64 *data_size)
+{
+	const struct wav_ds64 *d = data;
+	if (sizeof(struct wav_ds64) > len)
+		return -1;
+	*riff_size = ffint_le_cpu64_ptr(d->riff_size);
+	*data_size = ffint_le_cpu64_ptr(d->data_size);
+	return 0;
+}
+
+/** Write "ds64" chunk.
+It has the same size as a "JUNK" chunk reserved for it in the header.
+Return the number of bytes written */
+static inline int wav_ds64_write(void *dst, ffuint64 riff_size, ffuint64 data_size, ffuint64 samples)
+{
+	char *p = (char*)dst;
+	p += wav_chunk_write(p, "ds64", sizeof(struct wav_ds64));
+	struct wav_ds64 *d = (struct wav_ds64*)p;
+	*(ffuint64*)d->riff_size = ffint_le_cpu64(riff_size);
+	*(ffuint64*)d->data_size = ffint_le_cpu64(data_size);
+	*(ffuint64*)d->sample_count = ffint_le_cpu64(samples);
+	*(ffuint*)d->table_len = 0;
+	return sizeof(struct wav_chunkhdr) + sizeof(struct wav_ds64);
+}
+
 enum WAV_FMT {
 	WAV_FMT_PCM = 1,
 	WAV_FMT_IEEE_FLOAT = 3,
@@ -138,7 +176,8 @@ static inline int wav_fmt_write(void *data, const struct wav_info *info)
 
 /* Supported chunks:
 
-RIFF WAVE
+RIFF|RF64|BW64 WAVE
+ ds64
  "fmt "
  data
  LIST INFO
@@ -150,6 +189,7 @@ enum {
 	WAV_T_FMT,
 	WAV_T_LIST,
 	WAV_T_DATA,
+	WAV_T_DS64,
 
 	WAV_T_TAG = 0x80,
 };
@@ -179,9 +219,12 @@ static inline int wav_bchunk_find(const void *data, const struct wav_bchunk *ctx
 }
 
 static const struct wav_bchunk wav_ctx_global[] = {
+	{ "BW64", WAV_T_RIFF | WAV_MINSIZE(4) },
+	{ "RF64", WAV_T_RIFF | WAV_MINSIZE(4) },
 	{ "RIFF", WAV_T_RIFF | WAV_MINSIZE(4) | WAV_F_LAST },
 };
 static const struct wav_bchunk wav_ctx_riff[] = {
+	{ "ds64", WAV_T_DS64 | WAV_F_WHOLE },
 	{ "fmt ", WAV_T_FMT | WAV_F_WHOLE },
 	{ "LIST", WAV_T_LIST | WAV_MINSIZE(4) },
 	{ "data", WAV_T_DATA | WAV_F_LAST },
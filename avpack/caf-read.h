@@ -1,6 +1,4 @@
 /** avpack: .caf reader
-* no seeking
-
 2020,2021, Simon Zolin
 */
 
@@ -8,6 +6,7 @@
 cafread_open
 cafread_close
 cafread_process
+cafread_seek
 cafread_info
 cafread_error
 cafread_asc
@@ -26,6 +25,12 @@ cafread_tag
 
 typedef void (*caf_log_t)(void *udata, const char *fmt, va_list va);
 
+struct _cafr_seekpt {
+	ffuint64 frame;
+	ffuint64 off; // offset from the first packet
+	ffuint pakt_off;
+};
+
 typedef struct cafread {
 	ffuint state, nxstate;
 	ffsize gathlen;
@@ -42,6 +47,11 @@ typedef struct cafread {
 	ffstr pakt; // packets sizes
 	unsigned codec_conf_pending :1;
 
+	ffuint64 data_off; // offset of the first packet
+	ffuint64 data_size; // -1: unknown
+	ffuint64 seek_frame;
+	ffvec index; // struct _cafr_seekpt[]: every CAFREAD_INDEX_INTERVAL-th packet
+
 	ffstr tagname;
 	ffstr tagval;
 
@@ -83,6 +93,7 @@ static inline ffstr cafread_tag(cafread *c, ffstr *val)
 
 #define CAFREAD_CHUNK_MAXSIZE  (2*1024*1024) // max. meta chunk size
 #define CAFREAD_ACHUNK_MAXSIZE  (1*1024*1024) // max. audio chunk size
+#define CAFREAD_INDEX_INTERVAL  64
 
 static inline int cafread_open(cafread *c)
 {
@@ -102,6 +113,7 @@ static inline void cafread_close(cafread *c)
 	ffstream_free(&c->stream);
 	ffstr_free(&c->info.codec_conf);
 	ffstr_free(&c->pakt);
+	ffvec_free(&c->index);
 }
 
 static inline void _cafread_log(cafread *c, const char *fmt, ...)
@@ -154,6 +166,113 @@ static void _cafr_gather(cafread *c, ffuint nxstate, ffsize len)
 	c->gathlen = len;
 }
 
+/** Get the size and the number of frames of the packet at 'pakt_off'
+Return N of bytes read;
+ 0: no more entries;
+ <0: error */
+static int _cafr_pakt_next(cafread *c, ffuint pakt_off, ffuint *size, ffuint *frames)
+{
+	int r, r2;
+	if (0 >= (r = caf_varint(c->pakt.ptr + pakt_off, c->pakt.len - pakt_off, size)))
+		return r;
+
+	*frames = c->info.packet_frames;
+	if (*frames == 0) {
+		// variable frames per packet: pakt entry is (size, frames)
+		if (0 >= (r2 = caf_varint(c->pakt.ptr + pakt_off + r, c->pakt.len - pakt_off - r, frames)))
+			return -1;
+		r += r2;
+	}
+	return r;
+}
+
+/** Decode 'pakt' into the table of (frame, offset) for every Nth packet */
+static int _cafr_index_build(cafread *c)
+{
+	ffuint64 frame = 0, off = 0, ipkt = 0;
+	ffuint pakt_off = 0, size, frames;
+	int r;
+
+	for (;;) {
+		if (ipkt % CAFREAD_INDEX_INTERVAL == 0) {
+			struct _cafr_seekpt *sp = ffvec_pushT(&c->index, struct _cafr_seekpt);
+			if (sp == NULL)
+				return -1;
+			sp->frame = frame;
+			sp->off = off;
+			sp->pakt_off = pakt_off;
+		}
+
+		if (0 >= (r = _cafr_pakt_next(c, pakt_off, &size, &frames)))
+			break;
+		pakt_off += r;
+		off += size;
+		frame += frames;
+		ipkt++;
+	}
+	return 0;
+}
+
+/** Find the packet containing 'frame' and prepare to read it */
+static int _cafr_seek(cafread *c, ffuint64 frame)
+{
+	ffuint64 ipkt, off, fr;
+	ffuint pakt_off = 0;
+
+	if (c->info.packet_bytes != 0 && c->info.packet_frames != 0) {
+		// constant packet size: no need for the table
+		ipkt = frame / c->info.packet_frames;
+		fr = ipkt * c->info.packet_frames;
+		off = ipkt * c->info.packet_bytes;
+
+	} else {
+		if (c->index.len == 0
+			&& 0 != _cafr_index_build(c))
+			return _CAFR_ERR(c, "not enough memory");
+
+		// binary search the last point before or at 'frame'
+		const struct _cafr_seekpt *sp = (struct _cafr_seekpt*)c->index.ptr;
+		ffsize lo = 0, hi = c->index.len;
+		while (hi - lo > 1) {
+			ffsize m = lo + (hi - lo) / 2;
+			if (sp[m].frame <= frame)
+				lo = m;
+			else
+				hi = m;
+		}
+		ipkt = lo * CAFREAD_INDEX_INTERVAL;
+		fr = sp[lo].frame;
+		off = sp[lo].off;
+		pakt_off = sp[lo].pakt_off;
+
+		// walk through the rest of packets
+		ffuint size, frames;
+		int r;
+		for (;;) {
+			if (0 >= (r = _cafr_pakt_next(c, pakt_off, &size, &frames))
+				|| fr + frames > frame)
+				break;
+			pakt_off += r;
+			off += size;
+			fr += frames;
+			ipkt++;
+		}
+	}
+
+	if (c->data_size != (ffuint64)-1) {
+		if (off > c->data_size)
+			off = c->data_size;
+		c->chunk_size = c->data_size - off;
+	}
+	c->ipkt = ipkt;
+	c->iframe = fr;
+	c->nframes = 0;
+	c->pakt_off = pakt_off;
+	c->inoff = c->data_off + off;
+	ffstream_reset(&c->stream);
+	return 0;
+}
+
 /**
 Return enum CAFREAD_R */
 static inline int cafread_process(cafread *c, ffstr *input, ffstr *output)
@@ -163,6 +282,7 @@ static inline int cafread_process(cafread *c, ffstr *input, ffstr *output)
 		R_GATHER=1, R_CHUNK_HDR,
 		R_DATA, R_DATA_NEXT, R_DATA_CHUNK,
 		R_HDR, R_TAG, R_CHUNK, // CAF_T...
+		R_SEEK = 100,
 	};
 	int r;
 
@@ -273,14 +393,43 @@ static inline int cafread_process(cafread *c, ffstr *input, ffstr *output)
 			if (c->info.sample_rate == 0)
 				return _CAFR_ERR(c, "bad chunks order");
 
+			if (c->data_off != 0) {
+				// packet table follows audio data: go back to the data
+				ffstream_reset(&c->stream);
+				c->inoff = c->data_off - 4;
+				c->chunk_size = c->data_size + 4;
+				c->state = R_CHUNK + CAF_T_DATA;
+				return CAFREAD_SEEK;
+			}
+
 			_cafr_gather(c, R_CHUNK_HDR, sizeof(struct caf_chunk));
 			break;
 
 		case R_CHUNK + CAF_T_DATA:
+			if (c->data_off == 0 && c->info.packet_bytes == 0 && c->pakt.len == 0
+				&& (ffint64)c->chunk_size != -1) {
+				// VBR data without packet table: look for "pakt" after the data
+				c->data_off = c->inoff - ffstream_used(&c->stream) + 4;
+				c->data_size = c->chunk_size - 4;
+				_cafr_gather(c, R_CHUNK_HDR, sizeof(struct caf_chunk));
+				ffstream_reset(&c->stream);
+				c->inoff = c->data_off + c->data_size;
+				return CAFREAD_SEEK;
+			}
+
 			_cafr_gather(c, R_DATA_NEXT, 4); // skip "edit count" field
-			c->chunk_size -= 4;
+			if ((ffint64)c->chunk_size != -1)
+				c->chunk_size -= 4;
+			c->data_off = c->inoff - ffstream_used(&c->stream) + 4;
+			c->data_size = c->chunk_size;
 			return CAFREAD_HEADER;
 
+		case R_SEEK:
+			if (0 != _cafr_seek(c, c->seek_frame))
+				return CAFREAD_ERROR;
+			c->state = R_DATA_NEXT;
+			return CAFREAD_SEEK;
+
 		case R_DATA_NEXT: {
 			if (c->chunk_size == 0)
 				return CAFREAD_DONE;
@@ -291,7 +440,7 @@ static inline int cafread_process(cafread *c, ffstr *input, ffstr *output)
 			ffuint sz = c->info.packet_bytes;
 			c->nframes = c->info.packet_frames;
 			if (sz == 0) {
-				r = caf_varint(c->pakt.ptr + c->pakt_off, c->pakt.len - c->pakt_off, &sz);
+				r = _cafr_pakt_next(c, c->pakt_off, &sz, &c->nframes);
 				if (r == 0)
 					return CAFREAD_DONE;
 				if (r < 0)
@@ -341,10 +490,10 @@ static inline int cafread_process2(cafread *c, ffstr *input, union avpk_read_res
 		return AVPK_DATA;
 	}
 
-	int r = cafread_process(c, input, (ffstr*)&res->frame), n;
+	int r = cafread_process(c, input, (ffstr*)&res->frame);
 	switch (r) {
 	case AVPK_HEADER:
-		if (!(c->info.format & CAF_FMT_LE)) {
+		if (c->info.codec == AVPKC_PCM && !(c->info.format & CAF_FMT_LE)) {
 			res->error.message = "big-endian data isn't supported";
 			res->error.offset = ~0ULL;
 			return AVPK_ERROR;
@@ -361,8 +510,7 @@ static inline int cafread_process2(cafread *c, ffstr *input, union avpk_read_res
 	case AVPK_META:
 		res->tag.name = c->tagname;
 		res->tag.value = c->tagval;
-		n = ffszarr_ifindsorted(_vorbistag_str, FF_COUNT(_vorbistag_str), res->tag.name.ptr, res->tag.name.len);
-		res->tag.id = (n >= 0) ? _vorbistag_mmtag[n] : 0;
+		res->tag.id = vorbistag_find(res->tag.name.ptr, res->tag.name.len);
 		break;
 
 	case AVPK_DATA:
@@ -384,6 +532,16 @@ static inline int cafread_process2(cafread *c, ffstr *input, union avpk_read_res
 	return r;
 }
 
+/** Seek to the packet containing 'sample'.
+The packet table is decoded into the seek index on the first call. */
+static inline void cafread_seek(cafread *c, ffuint64 sample)
+{
+	if (c->data_off == 0)
+		return;
+	c->seek_frame = sample;
+	c->state = 100; // R_SEEK
+}
+
 #undef _CAFR_ERR
 
-AVPKR_IF_INIT(avpk_caf, "caf", AVPKF_CAF, cafread, cafread_open2, cafread_process2, NULL, cafread_close);
+AVPKR_IF_INIT(avpk_caf, "caf", AVPKF_CAF, cafread, cafread_open2, cafread_process2, cafread_seek, cafread_close);
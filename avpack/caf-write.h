@@ -0,0 +1,393 @@
+/** avpack: .caf writer
+* audio codec: PCM, ALAC, AAC
+* 1 track only
+
+2026, Simon Zolin
+*/
+
+/*
+cafwrite_create
+cafwrite_close
+cafwrite_addtag
+cafwrite_process
+cafwrite_error
+cafwrite_offset
+cafwrite_finish
+*/
+
+/* Output:
+HDR DESC [KUKI] [INFO] DATA(EDIT_COUNT PACKETS...) [PAKT]
+
+Audio Data chunk is written with size -1 ("until the end of file"),
+ so the file is valid at any moment, even if the writing process is interrupted.
+Packet Table chunk for VBR codecs is appended after the data,
+ then the real size of the data chunk is written (the only seek).
+*/
+
+#pragma once
+#include <avpack/decl.h>
+#include <avpack/base/caf.h>
+#include <avpack/vorbistag.h>
+#include <ffbase/vector.h>
+
+typedef struct cafwrite {
+	ffuint state;
+	const char *errmsg;
+	ffvec buf;
+	ffvec tags; // ("key" 0x00 "value" 0x00)...
+	ffuint ntags;
+	ffvec pakt; // packet sizes (varint)
+	caf_info info;
+	ffuint delay, padding;
+	ffuint64 npackets;
+	ffuint64 dsize; // audio data written
+	ffuint64 data_off; // offset of "data" chunk
+	ffuint64 data_size; // "data" chunk size in header
+	ffuint64 off;
+	ffuint fin :1;
+	ffuint have_codec_conf :1;
+
+	/** User: unbounded length, never seek back (PCM only).
+	"data" chunk size always remains -1. */
+	ffuint stream :1;
+} cafwrite;
+
+/**
+info.codec: AVPKC_PCM, AVPKC_ALAC, AVPKC_AAC
+info.format, sample_rate, channels are required
+info.total_frames is optional
+info.codec_conf: ALAC: ALACSpecificConfig;  AAC: AudioSpecificConfig;
+ empty: the first packet passed to cafwrite_process2() is the codec config
+Return 0 on success */
+static inline int cafwrite_create(cafwrite *c, const caf_info *info)
+{
+	c->info = *info;
+	ffstr_null(&c->info.codec_conf);
+	c->info.packet_bytes = 0;
+	switch (info->codec) {
+	case AVPKC_PCM:
+		c->info.packet_frames = 1;
+		c->info.packet_bytes = (info->format & 0xff) / 8 * info->channels;
+		if (c->info.packet_bytes == 0)
+			return 1;
+		c->have_codec_conf = 1;
+		break;
+
+	case AVPKC_AAC:
+		c->info.packet_frames = 1024;  break;
+
+	case AVPKC_ALAC:
+		c->info.packet_frames = 4096; // set from codec config
+		break;
+
+	default:
+		return 1;
+	}
+
+	if (info->codec_conf.len != 0) {
+		if (NULL == ffstr_dupstr(&c->info.codec_conf, &info->codec_conf))
+			return 1;
+		c->have_codec_conf = 1;
+	}
+	return 0;
+}
+
+static inline int cafwrite_create2(cafwrite *c, struct avpk_info *info)
+{
+	caf_info ci = {};
+	ci.codec = (info->codec != 0) ? info->codec : AVPKC_PCM;
+	ci.sample_rate = info->sample_rate;
+	ci.channels = info->channels;
+	ci.format = info->sample_bits | CAF_FMT_LE;
+	if (info->sample_float)
+		ci.format |= CAF_FMT_FLOAT;
+	ci.total_frames = info->duration;
+	ci.bitrate = info->audio_bitrate;
+	c->delay = info->delay;
+	c->padding = info->padding;
+	return cafwrite_create(c, &ci);
+}
+
+static inline void cafwrite_close(cafwrite *c)
+{
+	ffvec_free(&c->buf);
+	ffvec_free(&c->tags);
+	ffvec_free(&c->pakt);
+	ffstr_free(&c->info.codec_conf);
+}
+
+static inline const char* cafwrite_error(cafwrite *c)
+{
+	return c->errmsg;
+}
+
+/**
+Return 0 on success */
+static inline int cafwrite_addtag(cafwrite *c, ffstr name, ffstr val)
+{
+	if (name.len == 0 || ffstr_findchar(&name, '\0') >= 0 || ffstr_findchar(&val, '\0') >= 0)
+		return -1;
+
+	if (NULL == ffvec_grow(&c->tags, name.len + 1 + val.len + 1, 1))
+		return -1;
+	ffstr key = { name.len, ffslice_end(&c->tags, 1) };
+	ffvec_addstr(&c->tags, &name);
+	ffstr_lower(&key);
+	ffvec_addchar(&c->tags, '\0');
+	ffvec_addstr(&c->tags, &val);
+	ffvec_addchar(&c->tags, '\0');
+	c->ntags++;
+	return 0;
+}
+
+static inline int cafwrite_tag_add(cafwrite *c, unsigned id, ffstr name, ffstr val)
+{
+	if (id == MMTAG_VENDOR)
+		return 0;
+	if (id != 0) {
+		int i = ffarrint8_find(_vorbistag_mmtag, sizeof(_vorbistag_mmtag), id);
+		if (i < 0)
+			return 1;
+		ffstr_setz(&name, _vorbistag_str[i]);
+	}
+	return cafwrite_addtag(c, name, val);
+}
+
+#define _CAFW_ERR(c, e) \
+	(c)->errmsg = (e), CAFWRITE_ERROR
+
+enum CAFWRITE_R {
+	CAFWRITE_DATA = AVPK_DATA,
+	CAFWRITE_DONE = AVPK_FIN,
+	CAFWRITE_MORE = AVPK_MORE,
+	CAFWRITE_SEEK = AVPK_SEEK,
+	CAFWRITE_ERROR = AVPK_ERROR,
+};
+
+/** Write "kuki" chunk.
+dst: NULL: return the size only */
+static int _cafw_kuki(cafwrite *c, char *dst)
+{
+	const ffstr *conf = &c->info.codec_conf;
+	ffuint n = 0;
+	switch (c->info.codec) {
+	case AVPKC_ALAC:
+		n = conf->len;  break;
+
+	case AVPKC_AAC: {
+		struct caf_mp4_acodec ac = {
+			.type = 0x40, // MPEG-4 Audio
+			.stm_type = 0x15, // audio stream
+			.max_brate = c->info.bitrate,
+			.avg_brate = c->info.bitrate,
+			.conf = conf->ptr,
+			.conflen = conf->len,
+		};
+		n = caf_mp4_esds_write(NULL, &ac);
+		if (dst == NULL)
+			break;
+		dst += caf_chunk_write(dst, "kuki", n);
+		caf_mp4_esds_write(dst, &ac);
+		return sizeof(struct caf_chunk) + n;
+	}
+
+	default:
+		return 0;
+	}
+
+	if (dst != NULL) {
+		dst += caf_chunk_write(dst, "kuki", n);
+		ffmem_copy(dst, conf->ptr, n);
+	}
+	return sizeof(struct caf_chunk) + n;
+}
+
+/** Write the header and the beginning of "data" chunk */
+static int _cafw_hdr(cafwrite *c)
+{
+	ffsize cap = sizeof(struct caf_hdr)
+		+ sizeof(struct caf_chunk) + sizeof(struct caf_desc)
+		+ _cafw_kuki(c, NULL)
+		+ sizeof(struct caf_chunk) + sizeof(struct _caf_info) + c->tags.len
+		+ sizeof(struct caf_chunk) + 4;
+	if (NULL == ffvec_realloc(&c->buf, cap, 1))
+		return -1;
+
+	char *p = (char*)c->buf.ptr;
+	p += caf_hdr_write(p);
+	p += caf_chunk_write(p, "desc", sizeof(struct caf_desc));
+	p += caf_desc_write(p, &c->info);
+	p += _cafw_kuki(c, p);
+
+	if (c->ntags != 0) {
+		p += caf_chunk_write(p, "info", sizeof(struct _caf_info) + c->tags.len);
+		*(ffuint*)p = ffint_be_cpu32(c->ntags);
+		p += sizeof(struct _caf_info);
+		p = (char*)ffmem_copy(p, c->tags.ptr, c->tags.len);
+	}
+
+	c->data_size = (ffuint64)-1;
+	if (c->info.packet_bytes != 0 && c->info.total_frames != 0 && !c->stream)
+		c->data_size = 4 + c->info.total_frames * c->info.packet_bytes;
+
+	c->data_off = p - (char*)c->buf.ptr;
+	p += caf_chunk_write(p, "data", c->data_size);
+	*(ffuint*)p = 0; // edit count
+	p += 4;
+	c->buf.len = p - (char*)c->buf.ptr;
+	return 0;
+}
+
+/** Write "pakt" chunk header */
+static int _cafw_pakt_hdr(cafwrite *c)
+{
+	if (NULL == ffvec_realloc(&c->buf, sizeof(struct caf_chunk) + sizeof(struct caf_pakt), 1))
+		return -1;
+
+	ffuint64 frames = c->npackets * c->info.packet_frames;
+	ffuint64 valid = c->info.total_frames;
+	if (valid == 0 || valid + c->delay > frames)
+		valid = (frames > c->delay + c->padding) ? frames - c->delay - c->padding : 0;
+
+	char *p = (char*)c->buf.ptr;
+	p += caf_chunk_write(p, "pakt", sizeof(struct caf_pakt) + c->pakt.len);
+	p += caf_pakt_write(p, c->npackets, valid, c->delay, frames - c->delay - valid);
+	c->buf.len = p - (char*)c->buf.ptr;
+	return 0;
+}
+
+/**
+Return enum CAFWRITE_R */
+/*
+PCM:
+. Write header and data (-1 or the expected size)
+. Seek and write the real data size, if necessary (not in stream mode)
+
+VBR:
+. Write header and data (-1)
+. Write "pakt"
+. Seek and write the real data size
+*/
+static inline int cafwrite_process(cafwrite *c, ffstr *input, ffstr *output)
+{
+	enum {
+		W_HDR, W_DATA, W_PAKT, W_SIZE_SEEK, W_SIZE, W_DONE,
+	};
+
+	for (;;) {
+		switch (c->state) {
+		case W_HDR:
+			if (c->info.packet_bytes == 0 && c->stream)
+				return _CAFW_ERR(c, "streaming mode requires PCM");
+
+			if (c->info.codec == AVPKC_ALAC) {
+				if (c->info.codec_conf.len < 24)
+					return _CAFW_ERR(c, "bad ALAC config");
+				// ALACSpecificConfig: frameLength[4] compatibleVersion[1] bitDepth[1] ...
+				c->info.packet_frames = ffint_be_cpu32_ptr(c->info.codec_conf.ptr);
+				c->info.format = (ffbyte)c->info.codec_conf.ptr[5];
+			}
+
+			if (c->info.codec == AVPKC_AAC && c->info.codec_conf.len > CAF_MP4_ESDS_CONF_MAX)
+				return _CAFW_ERR(c, "too large AAC config");
+
+			if (0 != _cafw_hdr(c))
+				return _CAFW_ERR(c, "not enough memory");
+			ffstr_set2(output, &c->buf);
+			c->state = W_DATA;
+			return CAFWRITE_DATA;
+
+		case W_DATA:
+			if (input->len != 0) {
+				if (c->info.packet_bytes == 0) {
+					if (NULL == ffvec_grow(&c->pakt, 5, 1)) // 7 bits per byte: up to 5 bytes for 32-bit value
+						return _CAFW_ERR(c, "not enough memory");
+					c->pakt.len += caf_varint_write(ffslice_end(&c->pakt, 1), input->len);
+					c->npackets++;
+				}
+				c->dsize += input->len;
+				*output = *input;
+				input->len = 0;
+				return CAFWRITE_DATA;
+			}
+
+			if (!c->fin)
+				return CAFWRITE_MORE;
+
+			if (c->info.packet_bytes != 0) {
+				if (c->stream || c->data_size == 4 + c->dsize)
+					return CAFWRITE_DONE;
+				c->state = W_SIZE_SEEK;
+				continue;
+			}
+
+			if (0 != _cafw_pakt_hdr(c))
+				return _CAFW_ERR(c, "not enough memory");
+			ffstr_set2(output, &c->buf);
+			c->state = W_PAKT;
+			return CAFWRITE_DATA;
+
+		case W_PAKT:
+			c->state = W_SIZE_SEEK;
+			if (c->pakt.len == 0)
+				continue;
+			ffstr_set2(output, &c->pakt);
+			return CAFWRITE_DATA;
+
+		case W_SIZE_SEEK:
+			c->off = c->data_off + FF_OFF(struct caf_chunk, size);
+			c->state = W_SIZE;
+			return CAFWRITE_SEEK;
+
+		case W_SIZE:
+			*(ffuint64*)c->buf.ptr = ffint_be_cpu64(4 + c->dsize);
+			ffstr_set(output, c->buf.ptr, 8);
+			c->state = W_DONE;
+			return CAFWRITE_DATA;
+
+		case W_DONE:
+			return CAFWRITE_DONE;
+
+		default:
+			FF_ASSERT(0);
+			return CAFWRITE_ERROR;
+		}
+	}
+}
+
+static inline int cafwrite_process2(cafwrite *c, struct avpk_frame *frame, unsigned flags, union avpk_write_result *res)
+{
+	if (!c->have_codec_conf) {
+		if (!frame->len)
+			return AVPK_MORE;
+		c->have_codec_conf = 1;
+		ffstr_free(&c->info.codec_conf);
+		if (NULL == ffstr_dup(&c->info.codec_conf, frame->ptr, frame->len)) {
+			res->error.message = "not enough memory";
+			return AVPK_ERROR;
+		}
+		return AVPK_MORE;
+	}
+
+	if (flags & AVPKW_F_LAST)
+		c->fin = 1;
+
+	int r = cafwrite_process(c, (ffstr*)frame, &res->packet);
+	switch (r) {
+	case AVPK_SEEK:
+		res->seek_offset = c->off;
+		break;
+
+	case AVPK_ERROR:
+		res->error.message = c->errmsg;
+		break;
+	}
+	return r;
+}
+
+#undef _CAFW_ERR
+
+#define cafwrite_offset(c)  ((c)->off)
+#define cafwrite_finish(c)  ((c)->fin = 1)
+
+AVPKW_IF_INIT(avpkw_caf, "caf", AVPKF_CAF, cafwrite, cafwrite_create2, cafwrite_close, cafwrite_tag_add, cafwrite_process2);
@@ -79,12 +79,22 @@ struct avpk_frame {
 
 typedef void (*avpk_log_t)(void *opaque, const char *fmt, va_list va);
 
+/** Location of an embedded picture (AVPKR_F_PICTURE_REF) */
+struct avpk_picture {
+	ffuint64 offset; // absolute file offset of picture data
+	ffuint64 size;
+	ffstr mime; // e.g. "image/jpeg";  may be empty
+	unsigned type; // ID3v2/FLAC picture type, e.g. 3: front cover
+	unsigned width, height; // 0:unknown
+};
+
 union avpk_read_result {
 	struct avpk_info hdr;
 
 	struct {
 		unsigned id;
 		ffstr name, value;
+		struct avpk_picture picture; // MMTAG_PICTURE with AVPKR_F_PICTURE_REF ('value' is empty)
 	} tag;
 
 	struct avpk_frame frame;
@@ -103,11 +113,25 @@ struct avpk_reader_conf {
 	unsigned flags; // enum AVPKR_F
 	avpk_log_t log;
 	void *opaque;
+	unsigned tail_size; // Max size of data read at once from the end of file (APE, MP3, MPC, WV).  Default: 64KB
+
+	/** PCM: deinterleave audio data into per-channel buffers of 'planar_cap' samples (avpk_read()).
+	Output frame: ptr: 'planar';  len: bytes per channel;  duration: samples */
+	void **planar;
+	unsigned planar_cap;
+
+	/** Tag filter (ID3v2): return 0 to skip the tag field without reading its data.
+	id: enum MMTAG;  name: ID3v2 frame ID */
+	int (*tag_filter)(void *opaque, unsigned id, const char *name);
 };
 
 enum AVPKR_F {
 	AVPKR_F_AAC_FRAMES = 1, // return the whole ADTS frames (with header)
 	AVPKR_F_NO_SEEK = 2, // Disable auto seek requests even if `total_size` is set
+	AVPKR_F_INDEX = 4, // Build seek index for exact seeking (MP3, WavPack)
+	AVPKR_F_EXACT_DURATION = 8, // Scan the whole file if the header doesn't specify the duration (MP3)
+	AVPKR_F_DEFER_TAGS = 16, // Start audio right after the header; read tail tags after audio data (MPC)
+	AVPKR_F_PICTURE_REF = 32, // Return picture location rather than its data; skip the data (FLAC, MP3, MP4)
 };
 
 struct avpkr_if {
@@ -11,7 +11,7 @@ flacread_seek
 flacread_offset
 flacread_cursample
 flacread_samples
-flacread_meta_type flacread_meta_offset
+flacread_meta_type flacread_meta_offset flacread_meta_size
 */
 
 /* .flac format:
@@ -21,6 +21,7 @@ fLaC (HDR STREAMINFO) [HDR BLOCK]... (FRAME_HDR SUBFRAME... FRAME_FOOTER)...
 #pragma once
 #include <avpack/decl.h>
 #include <avpack/base/flac.h>
+#include <avpack/shared.h>
 #include <ffbase/stream.h>
 #include <ffbase/vector.h>
 
@@ -39,6 +40,8 @@ typedef struct flacread {
 	ffuint fin;
 	ffuint last_hdr_block;
 	ffuint meta_type;
+	ffuint meta_size;
+	ffuint64 meta_off;
 
 	struct flac_streaminfo streaminfo;
 	struct flac_info info;
@@ -50,6 +53,10 @@ typedef struct flacread {
 	struct flac_seekpt seekpt[2];
 	ffuint seek_init;
 
+	ffuint pic_ref; // User: output only the header of FLAC_TPIC block; skip picture data
+	ffuint tags_chunked; // User: output FLAC_TTAGS block data in chunks as it arrives, without gathering the whole block
+	ffuint skip; // N of bytes left to skip
+
 	flac_log_t log;
 	void *udata;
 } flacread;
@@ -60,11 +67,15 @@ enum FLACREAD_R {
 	FLACREAD_SEEK = AVPK_SEEK, // Use flacread_offset()
 	FLACREAD_DONE = AVPK_FIN,
 	FLACREAD_HEADER = AVPK_HEADER,
-	FLACREAD_META_BLOCK = _AVPK_META_BLOCK, // Output whole meta block body. Use flacread_meta_type() and flacread_meta_offset().
+	FLACREAD_META_BLOCK = _AVPK_META_BLOCK, // Output whole meta block body (or its next chunk: 'tags_chunked'). Use flacread_meta_type() and flacread_meta_offset().
 	FLACREAD_ERROR = AVPK_ERROR,
 	FLACREAD_HEADER_FIN = 100,
 };
 
+enum {
+	FLACREAD_PIC_HDR_MAX = 64*1024, // Max size of FLAC_TPIC block data read in 'pic_ref' mode
+};
+
 #define _FLACR_ERR(f, e) \
 	(f)->error = e,  FLACREAD_ERROR
 
@@ -87,6 +98,8 @@ static inline void flacread_open2(flacread *f, struct avpk_reader_conf *conf)
 	flacread_open(f, conf->total_size);
 	f->log = conf->log;
 	f->udata = conf->opaque;
+	f->pic_ref = !!(conf->flags & AVPKR_F_PICTURE_REF);
+	f->tags_chunked = 1;
 }
 
 static inline void flacread_close(flacread *f)
@@ -282,7 +295,7 @@ static inline int flacread_process(flacread *f, ffstr *input, ffstr *output)
 		I_INFO, I_META_BLOCK, I_META_NEXT, I_META, I_SEEK_TBL,
 		I_FRAME, I_FRAME_CHK, I_DONE,
 		I_SEEK_OFF, I_SEEK_FRAME,
-		I_GATHER, I_GATHER_SOME,
+		I_GATHER, I_GATHER_SOME, I_SKIP, I_META_CHUNK,
 	};
 	const ffuint MAX_NOFRAME = 100 * 1024*1024;
 	int r;
@@ -335,12 +348,24 @@ static inline int flacread_process(flacread *f, ffstr *input, ffstr *output)
 			ffuint blksize;
 			f->meta_type = r = flac_hdr_read(f->chunk.ptr, &blksize, &f->last_hdr_block);
 			_flacr_log(f, "meta block %u size:%u", r, blksize);
+			f->meta_size = blksize;
+			f->meta_off = f->off - ffstream_used(&f->stream) - f->chunk.len;
+
+			if (f->meta_type == FLAC_TTAGS && f->tags_chunked) {
+				f->skip = blksize;
+				f->state = I_META_CHUNK;
+				continue;
+			}
 
 			const ffuint MAX_META = 16 * 1024*1024;
 			if (blksize > MAX_META)
 				return _FLACR_ERR(f, "too large meta");
 
 			f->state = I_GATHER,  f->nextstate = I_META_BLOCK,  f->gather = blksize;
+			if (f->meta_type == FLAC_TPIC && f->pic_ref) {
+				f->gather = ffmin(blksize, FLACREAD_PIC_HDR_MAX);
+				f->skip = blksize - f->gather;
+			}
 			continue;
 		}
 
@@ -350,6 +375,57 @@ static inline int flacread_process(flacread *f, ffstr *input, ffstr *output)
 			f->state = I_META_NEXT;
 			if (f->meta_type == FLAC_TSEEKTABLE)
 				f->state = I_SEEK_TBL;
+			else if (f->skip != 0)
+				f->state = I_SKIP;
+			return FLACREAD_META_BLOCK;
+
+		case I_SKIP:
+			r = ffmin(ffstream_used(&f->stream), f->skip);
+			ffstream_consume(&f->stream, r);
+			f->skip -= r;
+			r = ffmin(input->len, f->skip);
+			ffstr_shift(input, r);
+			f->off += r;
+			f->skip -= r;
+			if (f->skip == 0) {
+				f->state = I_META_NEXT;
+				continue;
+			}
+
+			if (f->total_size != 0) {
+				f->off += f->skip;
+				f->skip = 0;
+				f->state = I_META_NEXT;
+				return FLACREAD_SEEK;
+			}
+
+			if (f->fin)
+				return _FLACR_ERR(f, "incomplete meta block");
+			return FLACREAD_MORE;
+
+		case I_META_CHUNK:
+			if (f->skip == 0) {
+				f->state = I_META_NEXT;
+				continue;
+			}
+
+			if (ffstream_used(&f->stream) != 0) {
+				ffstr v = ffstream_view(&f->stream);
+				r = ffmin(v.len, f->skip);
+				ffstr_set(output, v.ptr, r);
+				ffstream_consume(&f->stream, r);
+			} else {
+				if (input->len == 0) {
+					if (f->fin)
+						return _FLACR_ERR(f, "incomplete meta block");
+					return FLACREAD_MORE;
+				}
+				r = ffmin(input->len, f->skip);
+				ffstr_set(output, input->ptr, r);
+				ffstr_shift(input, r);
+				f->off += r;
+			}
+			f->skip -= r;
 			return FLACREAD_META_BLOCK;
 
 		case I_SEEK_TBL:
@@ -489,10 +565,35 @@ static inline int flacread_process2(flacread *f, ffstr *input, union avpk_read_r
 		case FLACREAD_META_BLOCK:
 			switch (f->meta_type) {
 			case FLAC_TTAGS:
+				// position of the chunk within the block body
+				res->frame.pos = (f->tags_chunked) ? f->meta_size - f->skip - res->frame.len : 0;
+				res->frame.end_pos = f->meta_size;
 				return r;
 			case FLAC_TPIC:
-				if (flac_meta_pic(*(ffstr*)&res->frame, &res->tag.value))
+				if (f->pic_ref) {
+					ffstr d = *(ffstr*)&res->frame;
+					struct flac_pichdr h;
+					if (flac_meta_pic_hdr(d, &h)) {
+						_flacr_log(f, "bad picture header");
+						continue;
+					}
+					struct avpk_picture *p = &res->tag.picture;
+					ffmem_zero_obj(p);
+					p->offset = f->off - ffstream_used(&f->stream) - f->chunk.len + h.data_off;
+					p->size = h.data_len;
+					p->mime = h.mime;
+					p->type = h.type;
+					p->width = h.width;
+					p->height = h.height;
+					if (p->width == 0) {
+						ffstr_shift(&d, h.data_off);
+						_avpack_pic_dimensions(d, &p->width, &p->height);
+					}
+					ffstr_null(&res->tag.value);
+
+				} else if (flac_meta_pic(*(ffstr*)&res->frame, &res->tag.value)) {
 					continue;
+				}
 				res->tag.id = MMTAG_PICTURE;
 				ffstr_setz(&res->tag.name, "PICTURE");
 				return AVPK_META;
@@ -540,7 +641,10 @@ static inline const struct flac_info* flacread_info(flacread *f)
 #define flacread_meta_type(f)  ((f)->meta_type)
 
 /** File offset at meta block header */
-#define flacread_meta_offset(f)  ((f)->off - ffstream_used(&(f)->stream) - sizeof(struct flac_hdr) - (f)->chunk.len)
+#define flacread_meta_offset(f)  ((f)->meta_off)
+
+/** Full size of meta block body (even if only a part of it is output) */
+#define flacread_meta_size(f)  ((f)->meta_size)
 
 /** Get an absolute sample number */
 #define flacread_cursample(f)  ((f)->frame.pos)
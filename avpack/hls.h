@@ -0,0 +1,362 @@
+/** avpack: HLS media playlist (.m3u8) reader
+2026, Simon Zolin
+*/
+
+/*
+hlsread_open hlsread_close
+hlsread_update
+hlsread_error
+*/
+
+/* HLS media playlist format:
+#EXTM3U
+#EXT-X-TARGETDURATION:SEC
+#EXT-X-MEDIA-SEQUENCE:N
+[#EXT-X-PROGRAM-DATE-TIME:YYYY-MM-DDThh:mm:ss[.sss](Z|+hh:mm)]
+[#EXT-X-BYTERANGE:LEN[@OFF]]
+#EXTINF:DUR_SEC[.FRAC],[TITLE]
+URL
+...
+[#EXT-X-ENDLIST]
+*/
+
+/* Live playlist update:
+The playlist is downloaded again and again; new segments are appended to the end
+ and the old segments may be removed from the beginning (EXT-X-MEDIA-SEQUENCE is increased).
+The reader remembers the offsets of the segments in the previous playlist
+ and the data of the last segment.
+After the header of the new playlist is parsed,
+ the position of the previous last segment in the new data is computed from MEDIA-SEQUENCE.
+If the data there is the same, only the segments after it are parsed.
+Otherwise the whole playlist is parsed, and only the segments
+ with a sequence number larger than the previously reported one are output.
+*/
+
+#pragma once
+
+#include <avpack/m3u.h>
+
+struct hls_segment {
+	ffuint64 seq; // Media sequence number
+	ffuint duration_msec; // #EXTINF
+	ffstr url; // Points to the data passed to hlsread_update()
+	ffuint64 range_off, range_len; // #EXT-X-BYTERANGE;  range_len=0: the whole resource
+	ffint64 date_msec; // #EXT-X-PROGRAM-DATE-TIME: UTC msec since 1970 (extrapolated for the next segments);  0: unknown
+};
+
+typedef struct hlsread {
+	const char *error;
+	ffuint64 media_seq; // #EXT-X-MEDIA-SEQUENCE
+	ffuint target_duration; // #EXT-X-TARGETDURATION
+	ffuint end; // #EXT-X-ENDLIST is found
+	ffuint full_parse; // N of times the whole playlist was parsed
+	ffvec segments; // struct hls_segment[]: new segments found by the last hlsread_update()
+
+	// The segments of the previous playlist.
+	// Offsets are "virtual": (virtual offset - vbase) = offset in the playlist data.
+	ffvec vstart; // ffuint64[]: start offsets of the segments
+	ffsize first; // index of the first segment in 'vstart'
+	ffuint64 seq_first; // sequence number of the first segment
+	ffuint64 vend; // end offset of the last segment
+	ffuint64 vbase;
+	ffvec last; // data of the last segment
+
+	ffuint64 seq_next; // sequence number of the next segment to output
+	ffuint64 range_next; // offset after the last byte range
+	ffint64 date_next; // date of the next segment
+} hlsread;
+
+static inline void hlsread_open(hlsread *h)
+{
+	(void)h;
+}
+
+static inline void hlsread_close(hlsread *h)
+{
+	ffvec_free(&h->segments);
+	ffvec_free(&h->vstart);
+	ffvec_free(&h->last);
+}
+
+static inline const char* hlsread_error(hlsread *h)
+{
+	return h->error;
+}
+
+#define _HLSR_ERR(h, e) \
+	(h)->error = (e),  -1
+
+/** Parse duration "SEC[.FRAC]" */
+static ffuint _hlsr_dur_msec(ffstr s)
+{
+	ffuint sec = 0, ms = 0, i, k;
+	for (i = 0;  i != s.len && (ffuint)(s.ptr[i] - '0') < 10;  i++) {
+		sec = sec * 10 + s.ptr[i] - '0';
+	}
+	if (i != s.len && s.ptr[i] == '.') {
+		i++;
+		for (k = 100;  i != s.len && (ffuint)(s.ptr[i] - '0') < 10;  i++, k /= 10) {
+			ms += (s.ptr[i] - '0') * k;
+		}
+	}
+	return sec * 1000 + ms;
+}
+
+/** Read N decimal digits */
+static int _hlsr_digits(const char *p, ffuint n)
+{
+	int r = 0;
+	for (ffuint i = 0;  i != n;  i++) {
+		if ((ffuint)(p[i] - '0') >= 10)
+			return -1;
+		r = r * 10 + p[i] - '0';
+	}
+	return r;
+}
+
+/** Parse date "YYYY-MM-DDThh:mm:ss[.sss](Z|+hh:mm|-hh:mm)"
+Return UTC msec since 1970;  0: bad date */
+static ffint64 _hlsr_date_msec(ffstr s)
+{
+	if (s.len < 19 || s.ptr[4] != '-' || s.ptr[7] != '-' || (s.ptr[10] | 0x20) != 't'
+		|| s.ptr[13] != ':' || s.ptr[16] != ':')
+		return 0;
+	int y = _hlsr_digits(s.ptr, 4), mon = _hlsr_digits(s.ptr + 5, 2), d = _hlsr_digits(s.ptr + 8, 2)
+		, hh = _hlsr_digits(s.ptr + 11, 2), mm = _hlsr_digits(s.ptr + 14, 2), ss = _hlsr_digits(s.ptr + 17, 2);
+	if ((y | mon | d | hh | mm | ss) < 0 || mon == 0 || mon > 12 || d == 0)
+		return 0;
+	ffstr_shift(&s, 19);
+
+	ffuint ms = 0;
+	if (s.len != 0 && s.ptr[0] == '.') {
+		ffsize i;
+		ffuint k = 100;
+		for (i = 1;  i != s.len && (ffuint)(s.ptr[i] - '0') < 10;  i++, k /= 10) {
+			ms += (s.ptr[i] - '0') * k;
+		}
+		ffstr_shift(&s, i);
+	}
+
+	int tz = 0; // minutes
+	if (s.len >= 5 && (s.ptr[0] == '+' || s.ptr[0] == '-')) {
+		ffuint mo = (s.ptr[3] == ':') ? 4 : 3; // "+hh:mm" or "+hhmm"
+		if (mo + 2 > s.len)
+			return 0;
+		int th = _hlsr_digits(s.ptr + 1, 2);
+		int tm = _hlsr_digits(s.ptr + mo, 2);
+		if ((th | tm) < 0)
+			return 0;
+		tz = th * 60 + tm;
+		if (s.ptr[0] == '-')
+			tz = -tz;
+	}
+
+	// days since 1970-01-01 in the proleptic Gregorian calendar
+	y -= (mon <= 2);
+	int era = y / 400;
+	int yoe = y - era * 400;
+	int doy = (153 * (mon + ((mon > 2) ? -3 : 9)) + 2) / 5 + d - 1;
+	int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	ffint64 days = (ffint64)era * 146097 + doe - 719468;
+
+	return ((days * 86400 + hh * 3600 + mm * 60 + ss - tz * 60) * 1000) + ms;
+}
+
+/** Get the next line */
+static int _hlsr_line(const char **p, const char *end, ffstr *line)
+{
+	if (*p == end)
+		return -1;
+	ffsize pos = _m3ur_find_lf(*p, end - *p);
+	ffstr_set(line, *p, pos);
+	*p += pos;
+	if (*p != end)
+		(*p)++;
+	ffstr_trimwhite(line);
+	return 0;
+}
+
+/** Check whether the line belongs to a media segment */
+static int _hlsr_segment_line(ffstr line)
+{
+	if (line.ptr[0] != '#')
+		return 1;
+	static const char *const tags[] = {
+		"#EXTINF:",
+		"#EXT-X-BYTERANGE:",
+		"#EXT-X-DISCONTINUITY",
+		"#EXT-X-GAP",
+		"#EXT-X-KEY:",
+		"#EXT-X-MAP:",
+		"#EXT-X-PROGRAM-DATE-TIME:",
+	};
+	for (ffuint i = 0;  i != FF_COUNT(tags);  i++) {
+		if (ffstr_imatchz(&line, tags[i])) {
+			if (i == 2 && line.len != FFS_LEN("#EXT-X-DISCONTINUITY"))
+				return 0; // #EXT-X-DISCONTINUITY-SEQUENCE
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/** Parse playlist header
+Return offset of the first segment */
+static ffsize _hlsr_header(hlsread *h, ffstr data)
+{
+	const char *p = data.ptr, *end = data.ptr + data.len;
+	ffstr line;
+	h->media_seq = 0;
+	h->end = 0;
+
+	for (;;) {
+		const char *ln = p;
+		if (0 != _hlsr_line(&p, end, &line))
+			break;
+		if (line.len == 0)
+			continue;
+		if (_hlsr_segment_line(line))
+			return ln - data.ptr;
+
+		if (ffstr_imatchz(&line, "#EXT-X-MEDIA-SEQUENCE:")) {
+			ffstr_shift(&line, FFS_LEN("#EXT-X-MEDIA-SEQUENCE:"));
+			(void)ffstr_toint(&line, &h->media_seq, FFS_INT64);
+
+		} else if (ffstr_imatchz(&line, "#EXT-X-TARGETDURATION:")) {
+			ffstr_shift(&line, FFS_LEN("#EXT-X-TARGETDURATION:"));
+			(void)ffstr_toint(&line, &h->target_duration, FFS_INT32);
+
+		} else if (ffstr_imatchz(&line, "#EXT-X-ENDLIST")) {
+			h->end = 1;
+		}
+	}
+	return data.len;
+}
+
+/** Parse the segments from 'off' to the end of data */
+static int _hlsr_segments(hlsread *h, ffstr data, ffsize off)
+{
+	const char *p = data.ptr + off, *end = data.ptr + data.len, *seg = p;
+	struct hls_segment cur = {};
+	ffstr line;
+
+	while (0 == _hlsr_line(&p, end, &line)) {
+		if (line.len == 0)
+			continue;
+
+		if (line.ptr[0] != '#') {
+			// URL: the segment is complete
+			cur.url = line;
+			cur.seq = h->seq_first + h->vstart.len - h->first;
+			if (cur.date_msec == 0 && h->date_next != 0)
+				cur.date_msec = h->date_next;
+
+			ffuint64 *vs = ffvec_pushT(&h->vstart, ffuint64);
+			if (vs == NULL)
+				return _HLSR_ERR(h, "not enough memory");
+			*vs = seg - data.ptr + h->vbase;
+			h->vend = p - data.ptr + h->vbase;
+
+			if (cur.seq >= h->seq_next) {
+				struct hls_segment *hs = ffvec_pushT(&h->segments, struct hls_segment);
+				if (hs == NULL)
+					return _HLSR_ERR(h, "not enough memory");
+				*hs = cur;
+				h->seq_next = cur.seq + 1;
+			}
+
+			if (cur.range_len != 0)
+				h->range_next = cur.range_off + cur.range_len;
+			h->date_next = (cur.date_msec != 0) ? cur.date_msec + cur.duration_msec : 0;
+			ffmem_zero_obj(&cur);
+			seg = p;
+			continue;
+		}
+
+		if (ffstr_imatchz(&line, "#EXTINF:")) {
+			ffstr_shift(&line, FFS_LEN("#EXTINF:"));
+			cur.duration_msec = _hlsr_dur_msec(line);
+
+		} else if (ffstr_imatchz(&line, "#EXT-X-BYTERANGE:")) {
+			ffstr_shift(&line, FFS_LEN("#EXT-X-BYTERANGE:"));
+			ffstr len, o;
+			ffstr_splitby(&line, '@', &len, &o);
+			cur.range_off = h->range_next;
+			if (!ffstr_toint(&len, &cur.range_len, FFS_INT64)
+				|| (o.len != 0 && !ffstr_toint(&o, &cur.range_off, FFS_INT64)))
+				cur.range_len = 0;
+
+		} else if (ffstr_imatchz(&line, "#EXT-X-PROGRAM-DATE-TIME:")) {
+			ffstr_shift(&line, FFS_LEN("#EXT-X-PROGRAM-DATE-TIME:"));
+			cur.date_msec = _hlsr_date_msec(line);
+
+		} else if (ffstr_imatchz(&line, "#EXT-X-ENDLIST")) {
+			h->end = 1;
+		}
+	}
+
+	// remember the last segment
+	h->last.len = 0;
+	if (h->vstart.len != h->first) {
+		ffuint64 last_off = ((ffuint64*)h->vstart.ptr)[h->vstart.len - 1] - h->vbase;
+		ffsize n = h->vend - h->vbase - last_off;
+		if (n != ffvec_add(&h->last, data.ptr + last_off, n, 1))
+			return _HLSR_ERR(h, "not enough memory");
+	}
+	return 0;
+}
+
+/** Process the new version of the playlist.
+data: the whole playlist;
+ must stay valid while the URLs of the new segments are in use
+'h->segments' is filled with the new segments:
+ the ones with the sequence number larger than reported before
+Return 0 on success;  <0: error (call hlsread_error()) */
+static inline int hlsread_update(hlsread *h, ffstr data)
+{
+	h->segments.len = 0;
+	ffsize hdr_end = _hlsr_header(h, data);
+	ffuint64 msn = h->media_seq;
+	ffsize n = h->vstart.len - h->first, off = 0;
+	int found = 0;
+
+	if (n != 0 && msn >= h->seq_first && msn - h->seq_first < n) {
+		// find the previous last segment in the new data
+		ffsize r = msn - h->seq_first;
+		const ffuint64 *vs = (ffuint64*)h->vstart.ptr + h->first;
+		ffuint64 vbase = vs[r] - hdr_end;
+		ffuint64 last_off = vs[n - 1] - vbase, last_end = h->vend - vbase;
+		if (last_end <= data.len
+			&& last_end - last_off == h->last.len
+			&& !ffmem_cmp(data.ptr + last_off, h->last.ptr, h->last.len)) {
+			h->first += r;
+			h->seq_first = msn;
+			h->vbase = vbase;
+			off = last_end;
+			found = 1;
+		}
+	}
+
+	if (!found) {
+		if (msn < h->seq_first)
+			h->seq_next = msn; // the playlist has been restarted
+		h->full_parse++;
+		h->vstart.len = h->first = 0;
+		h->seq_first = msn;
+		h->vbase = 0;
+		h->range_next = 0;
+		h->date_next = 0;
+		off = hdr_end;
+	}
+
+	if (h->first > h->vstart.len / 2) {
+		// remove the old segments
+		ffmem_move(h->vstart.ptr, (ffuint64*)h->vstart.ptr + h->first, (h->vstart.len - h->first) * sizeof(ffuint64));
+		h->vstart.len -= h->first;
+		h->first = 0;
+	}
+
+	return _hlsr_segments(h, data, off);
+}
+
+#undef _HLSR_ERR
@@ -7,15 +7,19 @@ id3v2read_open id3v2read_close
 id3v2read_process
 id3v2read_error
 id3v2read_size
+id3v2read_offset
+id3v2read_filter_text
 id3v2write_create id3v2write_close
 id3v2write_add id3v2write_add_txxx
 id3v2write_finish
 */
 
 #pragma once
+#include <avpack/decl.h>
 #include <avpack/base/id3v2.h>
 #include <avpack/id3v1.h>
 #include <avpack/mmtag.h>
+#include <avpack/shared.h>
 #include <ffbase/stream.h>
 #include <ffbase/vector.h>
 #include <ffbase/unicode.h>
@@ -38,6 +42,22 @@ struct id3v2read {
 
 	ffuint codepage;
 	ffuint as_is; // return whole frames as-is
+
+	/** User: frame filter: return 0 to skip the frame without reading its data.
+	tag: enum MMTAG;  id: frame ID */
+	int (*filter)(void *opaque, ffuint tag, const char *id);
+	void *filter_opaque;
+	ffuint allow_seek; // User: skip the frames not fitting into input with ID3V2READ_SEEK
+	ffuint skip; // N of bytes left to skip
+
+	/** User: return APIC frames with empty value and 'picture' describing the data; skip the data.
+	Frames with unsynchronisation are returned as usual. */
+	ffuint pic_ref;
+	struct avpk_picture picture; // 'offset' is relative to the tag start
+};
+
+enum {
+	ID3V2READ_PIC_HDR_MAX = 4*1024, // Max size of APIC frame data read in 'pic_ref' mode
 };
 
 static inline void id3v2read_open(struct id3v2read *d)
@@ -58,9 +78,11 @@ enum ID3V2READ_R {
 	ID3V2READ_DONE, // done reading
 	ID3V2READ_WARN,
 	ID3V2READ_ERROR,
+	ID3V2READ_SEEK, // need input data at id3v2read_offset()
 };
 
 #define id3v2read_size(d)  (d)->hdr.size
+#define id3v2read_offset(d)  (d)->offset // offset from the beginning of the tag
 #define id3v2read_version(d)  (d)->hdr.version
 
 #define _ID3V2READ_ERR(d, e) \
@@ -78,61 +100,70 @@ static inline const char* id3v2read_error(struct id3v2read *d)
 	return d->error_s;
 }
 
+static const char _id3v2_frame_str[][4] = {
+	"APIC", // MMTAG_PICTURE // "MIME" \0 TYPE[1] "DESCRIPTION" \0 DATA[]
+	"COM\0", // MMTAG_COMMENT
+	"COMM", // MMTAG_COMMENT
+	"PIC\0", // MMTAG_PICTURE
+	"TAL\0", // MMTAG_ALBUM
+	"TALB", // MMTAG_ALBUM
+	"TCO\0", // MMTAG_GENRE
+	"TCOM", // MMTAG_COMPOSER
+	"TCON", // MMTAG_GENRE // "Genre" | "(NN)Genre" | "(NN)" where NN is ID3v1 genre index
+	"TCOP", // MMTAG_COPYRIGHT
+	"TIT2", // MMTAG_TITLE
+	"TP1\0", // MMTAG_ARTIST
+	"TPE1", // MMTAG_ARTIST
+	"TPE2", // MMTAG_ALBUMARTIST
+	"TPUB", // MMTAG_PUBLISHER
+	"TRCK", // MMTAG_TRACKNO // "N[/TOTAL]"
+	"TRK\0", // MMTAG_TRACKNO
+	"TT2\0", // MMTAG_TITLE
+	"TYE\0", // MMTAG_DATE
+	"TYER", // MMTAG_DATE
+	"USLT", // MMTAG_LYRICS
+};
+static const ffbyte _id3v2_frame_mmtag[] = {
+	MMTAG_PICTURE,
+	MMTAG_COMMENT,
+	MMTAG_COMMENT,
+	MMTAG_PICTURE,
+	MMTAG_ALBUM,
+	MMTAG_ALBUM,
+	MMTAG_GENRE,
+	MMTAG_COMPOSER,
+	MMTAG_GENRE,
+	MMTAG_COPYRIGHT,
+	MMTAG_TITLE,
+	MMTAG_ARTIST,
+	MMTAG_ARTIST,
+	MMTAG_ALBUMARTIST,
+	MMTAG_PUBLISHER,
+	MMTAG_TRACKNO,
+	MMTAG_TRACKNO,
+	MMTAG_TITLE,
+	MMTAG_DATE,
+	MMTAG_DATE,
+	MMTAG_LYRICS,
+};
+
+/** Get MMTAG by frame ID (v2.2 ID is padded with '\0').
+Return enum MMTAG */
+static inline int id3v2_frame_find(const char id[4])
+{
+	ffuint i = _id3v2_frame_hash[_mmtag_hash_id(id, ID3V2_FRAME_HASH_SEED, ID3V2_FRAME_HASH_BITS)];
+	if (i == 0 || ffmem_cmp(id, _id3v2_frame_str[i - 1], 4))
+		return MMTAG_UNKNOWN;
+	return _id3v2_frame_mmtag[i - 1];
+}
+
 static int _id3v2r_frame_read(struct id3v2read *d, ffstr in)
 {
 	int r;
 	if ((r = id3v2_frame_read(&d->frame, in, d->hdr.version)) < 0)
 		return -1;
 	d->body_off = r;
-
-	static const char id3v2_frame_str[][4] = {
-		"APIC", // MMTAG_PICTURE // "MIME" \0 TYPE[1] "DESCRIPTION" \0 DATA[]
-		"COM\0", // MMTAG_COMMENT
-		"COMM", // MMTAG_COMMENT
-		"PIC\0", // MMTAG_PICTURE
-		"TAL\0", // MMTAG_ALBUM
-		"TALB", // MMTAG_ALBUM
-		"TCO\0", // MMTAG_GENRE
-		"TCOM", // MMTAG_COMPOSER
-		"TCON", // MMTAG_GENRE // "Genre" | "(NN)Genre" | "(NN)" where NN is ID3v1 genre index
-		"TCOP", // MMTAG_COPYRIGHT
-		"TIT2", // MMTAG_TITLE
-		"TP1\0", // MMTAG_ARTIST
-		"TPE1", // MMTAG_ARTIST
-		"TPE2", // MMTAG_ALBUMARTIST
-		"TPUB", // MMTAG_PUBLISHER
-		"TRCK", // MMTAG_TRACKNO // "N[/TOTAL]"
-		"TRK\0", // MMTAG_TRACKNO
-		"TT2\0", // MMTAG_TITLE
-		"TYE\0", // MMTAG_DATE
-		"TYER", // MMTAG_DATE
-		"USLT", // MMTAG_LYRICS
-	};
-	static const char id3v2_frame_int[] = {
-		MMTAG_PICTURE,
-		MMTAG_COMMENT,
-		MMTAG_COMMENT,
-		MMTAG_PICTURE,
-		MMTAG_ALBUM,
-		MMTAG_ALBUM,
-		MMTAG_GENRE,
-		MMTAG_COMPOSER,
-		MMTAG_GENRE,
-		MMTAG_COPYRIGHT,
-		MMTAG_TITLE,
-		MMTAG_ARTIST,
-		MMTAG_ARTIST,
-		MMTAG_ALBUMARTIST,
-		MMTAG_PUBLISHER,
-		MMTAG_TRACKNO,
-		MMTAG_TRACKNO,
-		MMTAG_TITLE,
-		MMTAG_DATE,
-		MMTAG_DATE,
-		MMTAG_LYRICS,
-	};
-	r = ffcharr_findsorted(id3v2_frame_str, FF_COUNT(id3v2_frame_str), 4, d->frame.id, 4);
-	return (r >= 0) ? id3v2_frame_int[r] : MMTAG_UNKNOWN;
+	return id3v2_frame_find(d->frame.id);
 }
 
 static int _id3v2read_text_decode(struct id3v2read *d, ffstr in, ffstr *out)
@@ -155,27 +186,23 @@ static int _id3v2read_text_decode(struct id3v2read *d, ffstr in, ffstr *out)
 		b->len = ffutf8_from_cp(b->ptr, b->cap, in.ptr, in.len, d->codepage);
 		break;
 
-	case ID3V2_UTF16BOM: {
-		ffsize len = in.len;
-		r = ffutf_bom(in.ptr, &len);
-		if (!(r == FFUNICODE_UTF16LE || r == FFUNICODE_UTF16BE))
-			return _ID3V2READ_WARN(d, "invalid BOM");
-		ffstr_shift(&in, len);
+	case ID3V2_UTF16BOM:
+	case ID3V2_UTF16BE: {
+		r = FFUNICODE_UTF16BE;
+		if (d->frame.encoding == ID3V2_UTF16BOM) {
+			ffsize len = in.len;
+			r = ffutf_bom(in.ptr, &len);
+			if (!(r == FFUNICODE_UTF16LE || r == FFUNICODE_UTF16BE))
+				return _ID3V2READ_WARN(d, "invalid BOM");
+			ffstr_shift(&in, len);
+		}
 
-		n = ffutf8_from_utf16(NULL, 0, in.ptr, in.len, r);
-		if (NULL == ffvec_realloc(b, n, 1))
+		if (NULL == ffvec_realloc(b, in.len / 2 * 3, 1))
 			return _ID3V2READ_WARN(d, "not enough memory");
-		b->len = ffutf8_from_utf16(b->ptr, b->cap, in.ptr, in.len, r);
+		b->len = id3v2_utf16_utf8(b->ptr, in.ptr, in.len, (r == FFUNICODE_UTF16BE));
 		break;
 	}
 
-	case ID3V2_UTF16BE:
-		n = ffutf8_from_utf16(NULL, 0, in.ptr, in.len, FFUNICODE_UTF16BE);
-		if (NULL == ffvec_realloc(b, n, 1))
-			return _ID3V2READ_WARN(d, "not enough memory");
-		b->len = ffutf8_from_utf16(b->ptr, b->cap, in.ptr, in.len, FFUNICODE_UTF16BE);
-		break;
-
 	default:
 		return _ID3V2READ_WARN(d, "invalid encoding");
 	}
@@ -210,6 +237,13 @@ end:
 	*body = data;
 }
 
+/** Frame filter for id3v2read.filter: accept text frames only (no pictures, binary data) */
+static inline int id3v2read_filter_text(void *opaque, ffuint tag, const char *id)
+{
+	(void)opaque;
+	return (id[0] == 'T' || tag == MMTAG_COMMENT || tag == MMTAG_LYRICS);
+}
+
 /** Read next ID3v2 tag field.
 IMPORTANT: some input data may be kept in cache (read with ffstream_view(&d->stm)).
 Return >0: enum ID3V2READ_R
@@ -220,7 +254,7 @@ static inline int id3v2read_process(struct id3v2read *d, ffstr *input, ffstr *na
 		R_INIT, R_GATHER, R_HDR, R_HDR_EXT,
 		R_FR, R_FR_HDR, R_FR_DATA,
 		R_UNSYNC,
-		R_DATA, R_TRKTOTAL, R_PADDING,
+		R_DATA, R_TRKTOTAL, R_PADDING, R_SKIP, R_PIC,
 	};
 	int r;
 	ffuint n;
@@ -287,7 +321,84 @@ static inline int id3v2read_process(struct id3v2read *d, ffstr *input, ffstr *na
 			if ((r = _id3v2r_frame_read(d, d->chunk)) < 0)
 				return _ID3V2READ_ERR(d, "couldn't parse frame header");
 			d->tag = r;
+
+			if (d->filter != NULL
+				&& !d->filter(d->filter_opaque, d->tag, d->frame.id)) {
+				if (d->offset + d->frame.size > d->hdr.size)
+					return _ID3V2READ_ERR(d, "corrupt data");
+				n = ffmin(ffstream_used(&d->stm), d->frame.size);
+				ffstream_consume(&d->stm, n);
+				d->offset += n;
+				d->skip = d->frame.size - n;
+				d->state = R_SKIP;
+				continue;
+			}
+
 			d->state = R_GATHER,  d->nextstate = R_FR_DATA,  d->gather_size = d->frame.size;
+			if (d->tag == MMTAG_PICTURE && d->pic_ref
+				&& !((d->frame.flags & ID3V2_FRAME_UNSYNC) || (d->hdr.flags & ID3V2_HDR_UNSYNC))) {
+				d->nextstate = R_PIC;
+				d->gather_size = ffmin(d->frame.size, ID3V2READ_PIC_HDR_MAX);
+			}
+			continue;
+
+		case R_PIC: {
+			if (d->offset + d->frame.size > d->hdr.size)
+				return _ID3V2READ_ERR(d, "corrupt data");
+
+			ffstr body = d->chunk;
+			ffstr_shift(&body, d->body_off);
+			struct id3v2_pic pic;
+			if (id3v2_pic_read(body, d->hdr.version, d->frame.encoding, &pic)) {
+				// too large or invalid header: read the whole frame
+				d->state = R_GATHER,  d->nextstate = R_FR_DATA,  d->gather_size = d->frame.size;
+				continue;
+			}
+
+			struct avpk_picture *p = &d->picture;
+			ffmem_zero_obj(p);
+			p->offset = d->offset + d->body_off + pic.data_off;
+			p->size = d->frame.size - d->body_off - pic.data_off;
+			p->mime = pic.mime;
+			if (d->hdr.version == 2) {
+				if (ffstr_ieqz(&pic.mime, "JPG"))
+					ffstr_setz(&p->mime, "image/jpeg");
+				else if (ffstr_ieqz(&pic.mime, "PNG"))
+					ffstr_setz(&p->mime, "image/png");
+			}
+			p->type = pic.type;
+			ffstr_shift(&body, pic.data_off);
+			_avpack_pic_dimensions(body, &p->width, &p->height);
+
+			n = ffmin(ffstream_used(&d->stm), d->frame.size);
+			ffstream_consume(&d->stm, n);
+			d->offset += n;
+			d->skip = d->frame.size - n;
+			d->state = R_SKIP;
+			ffstr_setz(name, d->frame.id);
+			ffstr_null(value);
+			return -MMTAG_PICTURE;
+		}
+
+		case R_SKIP:
+			if (d->skip == 0) {
+				d->state = R_FR;
+				continue;
+			}
+
+			if (d->skip > input->len && d->allow_seek) {
+				d->offset += d->skip;
+				d->skip = 0;
+				d->state = R_FR;
+				return ID3V2READ_SEEK;
+			}
+
+			if (input->len == 0)
+				return ID3V2READ_MORE;
+			n = ffmin(d->skip, input->len);
+			ffstr_shift(input, n);
+			d->offset += n;
+			d->skip -= n;
 			continue;
 
 		case R_FR_DATA:
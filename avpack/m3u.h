@@ -5,6 +5,7 @@
 /*
 m3uread_open m3uread_close
 m3uread_process
+m3uread_bulk
 m3uread_duration_sec
 m3uread_line
 m3uread_error
@@ -24,6 +25,12 @@ m3uwrite_fin
 #include <ffbase/vector.h>
 #include <ffbase/stringz.h>
 
+#if defined __AVX2__
+	#include <immintrin.h>
+#elif defined __SSE2__
+	#include <emmintrin.h>
+#endif
+
 typedef struct m3uread {
 	ffuint state;
 	ffuint line_num;
@@ -63,6 +70,19 @@ enum M3UREAD_R {
 	M3UREAD_EXT, // unrecognized line starting with #
 };
 
+/** Parse the duration from #EXTINF line (after "#EXTINF:") and shift the line
+Return N of bytes parsed;  0: no duration */
+static ffuint _m3ur_extinf_dur(ffstr *line, int *dur)
+{
+	int d;
+	ffuint n = ffs_toint(line->ptr, line->len, &d, FFS_INT32 | FFS_INTSIGN);
+	if (n == 0)
+		return 0;
+	*dur = (d > 0) ? d : 0;
+	ffstr_shift(line, n);
+	return n;
+}
+
 /**
 Return enum M3UREAD_R */
 static inline int m3uread_process(m3uread *m, ffstr *input, ffstr *output)
@@ -112,13 +132,12 @@ static inline int m3uread_process(m3uread *m, ffstr *input, ffstr *output)
 		} else if (ffstr_imatchz(&line, "#EXTINF:")) {
 			ffstr_shift(&line, FFS_LEN("#EXTINF:"));
 			int dur;
-			ffuint n = ffs_toint(line.ptr, line.len, &dur, FFS_INT32 | FFS_INTSIGN);
+			ffuint n = _m3ur_extinf_dur(&line, &dur);
 			if (n == 0)
 				continue;
 
-			ffstr_set(output, line.ptr, n);
-			m->dur = (dur > 0) ? dur : 0;
-			ffstr_shift(&line, n);
+			ffstr_set(output, line.ptr - n, n);
+			m->dur = dur;
 			if (line.len >= 2 && line.ptr[0] == ',') {
 				ffstr_shift(&line, 1);
 				m->line = line;
@@ -151,6 +170,130 @@ static inline int m3uread_process(m3uread *m, ffstr *input, ffstr *output)
 	}
 }
 
+typedef struct m3uread_entry {
+	ffstr url;
+	ffstr artist, title;
+	int duration_sec; // -1: no #EXTINF
+} m3uread_entry;
+
+/** Find '\n' by 16-byte blocks (32 with AVX2)
+Return the position of '\n';  'len' if not found */
+static inline ffsize _m3ur_find_lf(const char *p, ffsize len)
+{
+	ffsize i = 0;
+
+#if defined __SSE2__
+	ffuint m;
+
+#if defined __AVX2__
+	const __m256i lf32 = _mm256_set1_epi8('\n');
+	for (;  i + 32 <= len;  i += 32) {
+		__m256i v = _mm256_loadu_si256((__m256i*)(p + i));
+		if ((m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, lf32))))
+			return i + ffbit_rfind32(m) - 1;
+	}
+#endif
+
+	const __m128i lf = _mm_set1_epi8('\n');
+	for (;  i + 16 <= len;  i += 16) {
+		__m128i v = _mm_loadu_si128((__m128i*)(p + i));
+		if ((m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, lf))))
+			return i + ffbit_rfind32(m) - 1;
+	}
+#endif // __SSE2__
+
+	for (;  i != len;  i++) {
+		if (p[i] == '\n')
+			break;
+	}
+	return i;
+}
+
+/** Parse all complete entries from the buffer in one pass.
+The data is not copied: the strings in 'ents' point to 'input' data.
+An entry is complete after its URL line.
+'input' is shifted to the beginning of the first incomplete entry (buffer edge):
+ the caller passes this tail again followed by the next data,
+ or passes it to m3uread_process() if there's no more data.
+Don't mix with m3uread_process() in the middle of a line.
+ents: array of 'cap' entries
+Return N of entries written */
+static inline ffsize m3uread_bulk(m3uread *m, ffstr *input, m3uread_entry *ents, ffsize cap)
+{
+	const char *p = input->ptr, *end = input->ptr + input->len, *tail = p;
+	ffuint lines = 0, bom = m->bom;
+	ffsize n = 0;
+	m3uread_entry *e = ents;
+	if (cap == 0)
+		return 0;
+	ffmem_zero_obj(e);
+	e->duration_sec = -1;
+
+	for (;;) {
+		ffsize pos = _m3ur_find_lf(p, end - p);
+		if (p + pos == end)
+			break;
+
+		ffstr line = FFSTR_INITN(p, pos);
+		p += pos + 1;
+		lines++;
+		while (line.len != 0 && (ffbyte)line.ptr[line.len - 1] <= ' ')
+			line.len--; // CR and trailing whitespace
+		while (line.len != 0 && (ffbyte)line.ptr[0] <= ' ')
+			ffstr_shift(&line, 1);
+		if (line.len == 0)
+			continue;
+
+		if (!bom) {
+			bom = 1;
+			if (ffstr_matchz(&line, "\xef\xbb\xbf")) // UTF-8 BOM
+				ffstr_shift(&line, 3);
+			if (line.len == 0)
+				continue;
+		}
+
+		if (line.ptr[0] != '#') {
+			e->url = line;
+			tail = p;
+			m->bom = 1;
+			m->line_num += lines;
+			lines = 0;
+			if (++n == cap)
+				break;
+			e++;
+			ffmem_zero_obj(e);
+			e->duration_sec = -1;
+			continue;
+		}
+
+		// "#EXTINF:", case-insensitive: only the letters are converted to lower case
+		if (line.len >= 8
+			&& (ffint_le_cpu64_ptr(line.ptr) | 0x0020202020202000ULL) == ffint_le_cpu64_ptr("#extinf:")) {
+			ffstr_shift(&line, FFS_LEN("#EXTINF:"));
+			int dur;
+			if (0 == _m3ur_extinf_dur(&line, &dur))
+				continue;
+
+			e->duration_sec = dur;
+			ffstr_null(&e->artist);
+			ffstr_null(&e->title);
+			if (line.len >= 2 && line.ptr[0] == ',') {
+				ffstr_shift(&line, 1);
+				int div = ffstr_find(&line, " - ", 3);
+				if (div >= 0) {
+					ffstr_set(&e->artist, line.ptr, div);
+					ffstr_shift(&line, div+3);
+				}
+				e->title = line;
+			}
+		}
+		// #EXTM3U and the other lines starting with # are skipped
+	}
+
+	ffstr_shift(input, tail - input->ptr);
+	return n;
+}
+
 #define m3uread_duration_sec(m)  ((m)->dur)
 #define m3uread_line(m)  ((m)->line_num)
 
@@ -824,7 +824,7 @@ static inline int mkvread_process(mkvread *m, ffstr *input, ffstr *output)
 
 static inline int mkvread_process2(mkvread *m, ffstr *input, union avpk_read_result *res)
 {
-	int r, n;
+	int r;
 	switch (m->codec_conf_state) {
 	case 1: {
 		m->codec_conf_state = 0;
@@ -890,8 +890,7 @@ static inline int mkvread_process2(mkvread *m, ffstr *input, union avpk_read_res
 		case AVPK_META:
 			res->tag.name = *(ffstr*)&m->tagname;
 			res->tag.value = m->tagval;
-			n = ffszarr_ifindsorted(_vorbistag_str, FF_COUNT(_vorbistag_str), res->tag.name.ptr, res->tag.name.len);
-			res->tag.id = (n >= 0) ? _vorbistag_mmtag[n] : 0;
+			res->tag.id = vorbistag_find(res->tag.name.ptr, res->tag.name.len);
 			break;
 
 		case AVPK_DATA:
@@ -0,0 +1,37 @@
+/** avpack: perfect hash tables for tag name lookup
+Generated by mmtag-hash.py - don't edit
+*/
+
+#pragma once
+#include <ffbase/base.h>
+
+/** Vorbis comment field name (case-insensitive) -> _vorbistag_str[] */
+#define VORBISTAG_HASH_SEED  0x811c9df4U
+#define VORBISTAG_HASH_BITS  5
+static const ffbyte _vorbistag_hash[32] = {
+	0, 10, 0, 0, 15, 16, 5, 9, 8, 0, 0, 3, 0, 0, 2, 4,
+	0, 0, 6, 0, 14, 0, 0, 12, 0, 11, 13, 0, 7, 1, 0, 0,
+};
+
+/** APE tag field name (case-insensitive) -> _apetag_str[] */
+#define APETAG_HASH_SEED  0x811c9eafU
+#define APETAG_HASH_BITS  4
+static const ffbyte _apetag_hash[16] = {
+	8, 4, 9, 11, 0, 7, 0, 0, 0, 5, 6, 0, 1, 3, 10, 2,
+};
+
+/** ID3v2 frame ID -> _id3v2_frame_str[] */
+#define ID3V2_FRAME_HASH_SEED  0x9e37d42fU
+#define ID3V2_FRAME_HASH_BITS  5
+static const ffbyte _id3v2_frame_hash[32] = {
+	7, 21, 5, 16, 8, 0, 6, 0, 0, 0, 9, 0, 0, 1, 2, 0,
+	19, 13, 20, 3, 11, 18, 10, 14, 0, 0, 0, 0, 4, 15, 17, 12,
+};
+
+/** MP4 "ilst" child box type -> mp4_ctx_ilst[] */
+#define MP4_ILST_HASH_SEED  0x9e377e5dU
+#define MP4_ILST_HASH_BITS  5
+static const ffbyte _mp4_ilst_hash[32] = {
+	1, 0, 0, 0, 18, 7, 5, 0, 0, 0, 0, 0, 8, 4, 6, 0,
+	9, 0, 13, 12, 17, 0, 16, 0, 15, 0, 0, 10, 3, 2, 11, 14,
+};
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+# avpack: generate perfect hash tables for tag name -> MMTAG lookup
+# 2026, Simon Zolin
+
+# Usage: python3 mmtag-hash.py > mmtag-hash.h
+# Run after changing the tag name tables in:
+#  vorbistag.h (_vorbistag_str), apetag.h (_apetag_str),
+#  id3v2.h (_id3v2_frame_str), base/mp4.h (mp4_ctx_ilst)
+# or enum MMTAG in mmtag.h.
+# The tables map a hash slot to (index+1) in the original name table; 0: empty slot.
+# Hash functions must match _mmtag_hash_str() and _mmtag_hash_id() in mmtag.h.
+
+import os
+import re
+import sys
+
+DIR = os.path.dirname(os.path.abspath(__file__))
+MAX_TRIES = 200000
+
+def read(fn):
+	with open(os.path.join(DIR, fn), 'rb') as f:
+		return f.read().decode('latin-1')
+
+def c_unescape(s):
+	r = bytearray()
+	i = 0
+	while i < len(s):
+		c = s[i]
+		if c != '\\':
+			r.append(ord(c))
+			i += 1
+			continue
+		m = re.match(r'[0-7]{1,3}', s[i+1:])
+		if m:
+			r.append(int(m.group(0), 8))
+			i += 1 + len(m.group(0))
+			continue
+		r.append({'n': 10, 't': 9, '\\': 92, '"': 34}[s[i+1]])
+		i += 2
+	return bytes(r)
+
+def c_array(src, name):
+	m = re.search(r'\b' + name + r'\[\]\s*(?:\[\d+\])?\s*=\s*\{(.*?)\};', src, re.S)
+	if m is None:
+		sys.exit('%s: not found' % name)
+	body = re.sub(r'//[^\n]*', '', m.group(1))
+	return body
+
+def c_strings(src, name):
+	return [c_unescape(s) for s in re.findall(r'"((?:[^"\\]|\\.)*)"', c_array(src, name))]
+
+def c_idents(src, name):
+	return re.findall(r'\b(MMTAG_\w+)', c_array(src, name))
+
+def lower(c):
+	return c | (0x20 if 0 <= c - 0x41 < 26 else 0)
+
+def hash_str(s, seed, bits):
+	h = seed
+	for c in s:
+		h = ((h ^ lower(c)) * 0x01000193) & 0xffffffff
+	return h >> (32 - bits)
+
+def hash_id(s, seed, bits):
+	k = int.from_bytes(s[:4].ljust(4, b'\0'), 'little')
+	return ((k * seed) & 0xffffffff) >> (32 - bits)
+
+def find_seed(keys, fhash, seed0, step):
+	bits = max(1, (len(keys) - 1).bit_length())
+	while True:
+		seed = seed0
+		for i in range(MAX_TRIES):
+			slots = set(fhash(k, seed, bits) for k in keys)
+			if len(slots) == len(keys):
+				return seed, bits
+			seed = (seed + step) & 0xffffffff
+		bits += 1
+
+def gen(out, prefix, keys, fhash, seed0, step, comment):
+	folded = [bytes(lower(c) for c in k) for k in keys] if fhash is hash_str else keys
+	if len(set(folded)) != len(folded):
+		sys.exit('%s: duplicate keys' % prefix)
+	seed, bits = find_seed(keys, fhash, seed0, step)
+	table = [0] * (1 << bits)
+	for i, k in enumerate(keys):
+		table[fhash(k, seed, bits)] = i + 1
+
+	out.append('/** %s */' % comment)
+	out.append('#define %s_HASH_SEED  0x%08xU' % (prefix.upper().lstrip('_'), seed))
+	out.append('#define %s_HASH_BITS  %u' % (prefix.upper().lstrip('_'), bits))
+	out.append('static const ffbyte %s_hash[%u] = {' % (prefix, len(table)))
+	for i in range(0, len(table), 16):
+		out.append('\t' + ' '.join('%u,' % v for v in table[i:i+16]))
+	out.append('};')
+	out.append('')
+
+def check_mmtags(names, tag_enum, where):
+	for n in names:
+		if n not in tag_enum:
+			sys.exit('%s: unknown %s' % (where, n))
+
+def main():
+	tag_enum = set(re.findall(r'\b(MMTAG_\w+)', c_array(read('mmtag.h').replace('enum MMTAG {', 'MMTAG[] = {'), 'MMTAG')))
+
+	out = []
+	out.append('/** avpack: perfect hash tables for tag name lookup')
+	out.append('Generated by mmtag-hash.py - don\'t edit')
+	out.append('*/')
+	out.append('')
+	out.append('#pragma once')
+	out.append('#include <ffbase/base.h>')
+	out.append('')
+
+	src = read('vorbistag.h')
+	keys = c_strings(src, '_vorbistag_str')
+	tags = c_idents(src, '_vorbistag_mmtag')
+	if len(keys) != len(tags):
+		sys.exit('vorbistag.h: _vorbistag_str and _vorbistag_mmtag differ in size')
+	check_mmtags(tags, tag_enum, 'vorbistag.h')
+	gen(out, '_vorbistag', keys, hash_str, 0x811c9dc5, 1, 'Vorbis comment field name (case-insensitive) -> _vorbistag_str[]')
+
+	src = read('apetag.h')
+	keys = c_strings(src, '_apetag_str')
+	tags = c_idents(src, '_apetag_int')
+	if len(keys) != len(tags):
+		sys.exit('apetag.h: _apetag_str and _apetag_int differ in size')
+	check_mmtags(tags, tag_enum, 'apetag.h')
+	gen(out, '_apetag', keys, hash_str, 0x811c9dc5, 1, 'APE tag field name (case-insensitive) -> _apetag_str[]')
+
+	src = read('id3v2.h')
+	keys = c_strings(src, '_id3v2_frame_str')
+	tags = c_idents(src, '_id3v2_frame_mmtag')
+	if len(keys) != len(tags):
+		sys.exit('id3v2.h: _id3v2_frame_str and _id3v2_frame_mmtag differ in size')
+	check_mmtags(tags, tag_enum, 'id3v2.h')
+	gen(out, '_id3v2_frame', keys, hash_id, 0x9e3779b1, 2, 'ID3v2 frame ID -> _id3v2_frame_str[]')
+
+	src = read('base/mp4.h')
+	keys = c_strings(src, 'mp4_ctx_ilst')
+	gen(out, '_mp4_ilst', keys, hash_id, 0x9e3779b1, 2, 'MP4 "ilst" child box type -> mp4_ctx_ilst[]')
+
+	sys.stdout.write('\n'.join(out))
+
+main()
@@ -3,6 +3,7 @@
 */
 
 #pragma once
+#include <ffbase/base.h>
 
 enum MMTAG {
 	MMTAG_UNKNOWN,
@@ -27,3 +28,39 @@ enum MMTAG {
 
 	_MMTAG_N,
 };
+
+#include <avpack/mmtag-hash.h>
+
+/** ASCII lower case without branches */
+static inline ffuint _mmtag_lower(ffuint c)
+{
+	return c | (((ffuint)(c - 'A') < 26) << 5);
+}
+
+/** Hash a tag name, case-insensitive (FNV-1a).
+Return slot index in a table of 2^bits elements */
+static inline ffuint _mmtag_hash_str(const char *s, ffsize len, ffuint seed, ffuint bits)
+{
+	ffuint h = seed;
+	for (ffsize i = 0;  i != len;  i++) {
+		h = (h ^ _mmtag_lower((ffbyte)s[i])) * 0x01000193;
+	}
+	return h >> (32 - bits);
+}
+
+/** Hash a 4-byte ID (multiplicative).
+Return slot index in a table of 2^bits elements */
+static inline ffuint _mmtag_hash_id(const char id[4], ffuint seed, ffuint bits)
+{
+	return (ffint_le_cpu32_ptr(id) * seed) >> (32 - bits);
+}
+
+/** Compare a tag name with a NULL-terminated lower- or upper-case string, case-insensitive */
+static inline int _mmtag_ieq(const char *s, ffsize len, const char *sz)
+{
+	for (ffsize i = 0;  i != len;  i++) {
+		if (sz[i] == '\0' || _mmtag_lower((ffbyte)s[i]) != _mmtag_lower((ffbyte)sz[i]))
+			return 0;
+	}
+	return sz[len] == '\0';
+}
@@ -24,24 +24,19 @@ MPEG_HDR ((XING LAME) | VBRI)
 
 #pragma once
 #include <avpack/mpeg1-read.h>
-#include <avpack/id3v1.h>
 #include <avpack/id3v2.h>
-#include <avpack/apetag.h>
+#include <avpack/tailtag.h>
 
 typedef void (*mp3_log_t)(void *udata, const char *fmt, va_list va);
 
 typedef struct mp3read {
-	ffuint state, nextstate;
-	ffuint gather_size;
+	ffuint state;
 	mpeg1read rd;
-	ffvec buf;
-	ffstr chunk;
 	ffuint64 off, total_size;
 	ffuint options;
 
-	struct id3v1read id3v1;
 	struct id3v2read id3v2;
-	struct apetagread apetag;
+	struct tailtagread tail;
 	ffuint data_off;
 	ffuint tag; // enum MMTAG
 	ffstr tagname, tagval;
@@ -70,8 +65,14 @@ static inline void mp3read_open2(mp3read *m, struct avpk_reader_conf *conf)
 {
 	mp3read_open(m, conf->total_size);
 	m->options = conf->flags;
-	m->id3v1.codepage = conf->code_page;
+	m->tail.id3v1.codepage = conf->code_page;
+	m->tail.codepage = conf->code_page;
+	m->tail.window = conf->tail_size;
 	m->id3v2.codepage = conf->code_page;
+	m->id3v2.filter = conf->tag_filter;
+	m->id3v2.filter_opaque = conf->opaque;
+	m->id3v2.allow_seek = !(conf->flags & AVPKR_F_NO_SEEK);
+	m->id3v2.pic_ref = !!(conf->flags & AVPKR_F_PICTURE_REF);
 	m->log = conf->log;
 	m->udata = conf->opaque;
 }
@@ -79,9 +80,8 @@ static inline void mp3read_open2(mp3read *m, struct avpk_reader_conf *conf)
 static inline void mp3read_close(mp3read *m)
 {
 	id3v2read_close(&m->id3v2);
-	apetagread_close(&m->apetag);
+	tailtagread_close(&m->tail);
 	mpeg1read_close(&m->rd);
-	ffvec_free(&m->buf);
 }
 
 enum MP3READ_R {
@@ -97,15 +97,14 @@ Return enum MPEG1READ_R or enum MP3READ_R */
 /* MP3 reading algorithm:
 . read ID3v2 tag
 . seek to the end
-. read ID3v1 tag
-. read APE tag
+. read ID3v1, APE, Lyrics3 tags
 . seek to header
 . find MPEG-1/2 header and start reading frames */
 static inline int mp3read_process(mp3read *m, ffstr *input, ffstr *output)
 {
 	enum {
-		R_INIT, R_ID3V2, R_GATHER,
-		R_FTR_SEEK, R_ID3V1, R_APETAG_FTR, R_APETAG,
+		R_INIT, R_ID3V2,
+		R_FTR_SEEK, R_TAILTAG,
 		R_HDR_SEEK, R_HDR, R_FRAMES,
 	};
 	int r;
@@ -129,6 +128,9 @@ static inline int mp3read_process(mp3read *m, ffstr *input, ffstr *output)
 			switch (r) {
 			case ID3V2READ_MORE:
 				return MPEG1READ_MORE;
+			case ID3V2READ_SEEK:
+				m->off = id3v2read_offset(&m->id3v2);
+				return MPEG1READ_SEEK;
 			case ID3V2READ_NO:
 				break;
 			case ID3V2READ_DONE:
@@ -153,85 +155,37 @@ static inline int mp3read_process(mp3read *m, ffstr *input, ffstr *output)
 				continue;
 			}
 
-			if (m->data_off + sizeof(struct apetaghdr) + sizeof(struct id3v1) > m->total_size) {
+			if (m->data_off + sizeof(struct id3v1) > m->total_size) {
 				m->state = R_HDR;
 				if (m->total_size != 0 && m->data_off == 0)
 					m->state = R_HDR_SEEK; // no or bad ID3v2: some input data was consumed
 				continue;
 			}
-			m->state = R_GATHER,  m->nextstate = R_ID3V1;
-			m->gather_size = sizeof(struct apetaghdr) + sizeof(struct id3v1);
-			m->off = m->total_size - m->gather_size;
-			return MPEG1READ_SEEK;
-
-		case R_GATHER:
-			r = ffstr_gather((ffstr*)&m->buf, &m->buf.cap, input->ptr, input->len, m->gather_size, &m->chunk);
-			if (r < 0)
-				return _MPEG1R_ERR(&m->rd, "not enough memory");
-			ffstr_shift(input, r);
-			m->off += r;
-			if (m->chunk.len == 0)
-				return MPEG1READ_MORE;
-			m->buf.len = 0;
-			m->state = m->nextstate;
-			continue;
-
-		case R_ID3V1: {
-			ffstr id3;
-			ffstr_set(&id3, &m->chunk.ptr[m->chunk.len - sizeof(struct id3v1)], sizeof(struct id3v1));
-			r = id3v1read_process(&m->id3v1, id3, &m->tagval);
-			switch (r) {
-			case ID3V1READ_DONE:
-				m->total_size -= sizeof(struct id3v1);
-				m->chunk.len -= sizeof(struct id3v1);
-				m->off -= sizeof(struct id3v1);
-				break;
-			case ID3V1READ_NO:
-				break;
-			default:
-				m->tag = -r;
-				return MP3READ_ID31;
-			}
-		}
+			tailtagread_open(&m->tail, m->total_size);
+			m->tail.min_off = m->data_off;
+			m->state = R_TAILTAG;
 			// fallthrough
 
-		case R_APETAG_FTR: {
-			apetagread_open(&m->apetag);
-			ffint64 seek;
-			r = apetagread_footer(&m->apetag, m->chunk, &seek);
+		case R_TAILTAG:
+			r = tailtagread_process(&m->tail, input, &m->tagname, &m->tagval);
 			switch (r) {
-			case APETAGREAD_SEEK:
-				m->off += seek;
-				m->total_size = m->off;
-				m->state = R_APETAG;
+			case TAILTAGREAD_SEEK:
+				m->off = tailtagread_offset(&m->tail);
 				return MPEG1READ_SEEK;
-			default:
-				m->state = R_HDR_SEEK;
-				continue;
-			}
-			break;
-		}
-
-		case R_APETAG: {
-			ffsize len = input->len;
-			r = apetagread_process(&m->apetag, input, &m->tagname, &m->tagval);
-			m->off += len - input->len;
-			switch (r) {
-			case APETAGREAD_MORE:
+			case TAILTAGREAD_MORE:
 				return MPEG1READ_MORE;
-			case APETAGREAD_DONE:
-				apetagread_close(&m->apetag);
+			case TAILTAGREAD_WARN:
+				m->rd.error = tailtagread_error(&m->tail);
+				return MP3READ_WARN;
+			case TAILTAGREAD_DONE:
+				m->total_size = m->tail.total_size;
+				tailtagread_close(&m->tail);
 				m->state = R_HDR_SEEK;
 				break;
-			case APETAGREAD_ERROR:
-				m->state = R_HDR_SEEK;
-				m->rd.error = apetagread_error(&m->apetag);
-				return MP3READ_WARN;
 			default:
 				m->tag = -r;
 				return MP3READ_APETAG;
 			}
-		}
 			// fallthrough
 
 		case R_HDR_SEEK:
@@ -242,6 +196,10 @@ static inline int mp3read_process(mp3read *m, ffstr *input, ffstr *output)
 		case R_HDR: {
 			ffuint64 stream_size = (m->total_size != 0) ? m->total_size - m->data_off : 0;
 			mpeg1read_open(&m->rd, stream_size);
+			if (m->options & AVPKR_F_INDEX)
+				m->rd.index_interval = MPEG1READ_INDEX_INTERVAL;
+			if ((m->options & (AVPKR_F_EXACT_DURATION | AVPKR_F_NO_SEEK)) == AVPKR_F_EXACT_DURATION)
+				m->rd.options |= MPEG1READ_OPT_SCAN;
 			m->state = R_FRAMES;
 		}
 			// fallthrough
@@ -284,6 +242,8 @@ static inline int mp3read_process2(mp3read *m, ffstr *input, union avpk_read_res
 		res->tag.id = m->tag;
 		res->tag.name = m->tagname;
 		res->tag.value = m->tagval;
+		if (m->tag == MMTAG_PICTURE && m->id3v2.pic_ref && m->tagval.ptr == NULL)
+			res->tag.picture = m->id3v2.picture; // ID3v2 tag starts at offset 0
 		break;
 
 	case AVPK_DATA:
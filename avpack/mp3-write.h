@@ -30,6 +30,8 @@ typedef struct mp3write {
 	ffbyte frame1[4];
 	ffuint nframes;
 	ffuint nbytes;
+	ffvec toc_offsets; // ffuint[]: offset of every 'toc_interval'-th frame
+	ffuint toc_interval;
 
 	int vbr_scale; // -1:CBR; VBR:100(worst)..0(best)
 	ffuint options; // enum MP3WRITE_OPT
@@ -42,11 +44,16 @@ enum MP3WRITE_OPT {
 	MP3WRITE_XINGTAG = 4, // write custom Xing tag (incompatible with MP3WRITE_FLAMEFRAME)
 };
 
+enum {
+	_MP3W_TOC_OFFSETS_MAX = 400,
+};
+
 static inline void mp3write_create(mp3write *m)
 {
 	m->options = MP3WRITE_ID3V1 | MP3WRITE_ID3V2;
 	m->id3v2_min_size = 1000;
 	m->vbr_scale = -1;
+	m->toc_interval = 1;
 }
 
 static inline int mp3write_create2(mp3write *m, struct avpk_info *info)
@@ -64,6 +71,7 @@ static inline void mp3write_close(mp3write *m)
 	}
 	ffvec_free(&m->tags);
 	ffvec_free(&m->buf);
+	ffvec_free(&m->toc_offsets);
 }
 
 /**
@@ -104,6 +112,30 @@ enum MP3WRITE_F {
 	MP3WRITE_FLAMEFRAME = AVPKW_F_MP3_LAME, // this packet is LAME frame
 };
 
+/** Remember the offset of the next frame for Xing TOC.
+The number of offsets is limited: the interval is doubled when the array is full. */
+static void _mp3w_toc_add(mp3write *m)
+{
+	if (m->nframes % m->toc_interval != 0)
+		return;
+
+	if (m->toc_offsets.len == _MP3W_TOC_OFFSETS_MAX) {
+		ffuint *o = (ffuint*)m->toc_offsets.ptr;
+		for (ffuint i = 0;  i < _MP3W_TOC_OFFSETS_MAX / 2;  i++) {
+			o[i] = o[i * 2];
+		}
+		m->toc_offsets.len = _MP3W_TOC_OFFSETS_MAX / 2;
+		m->toc_interval *= 2;
+		if (m->nframes % m->toc_interval != 0)
+			return;
+	}
+
+	ffuint *p;
+	if (NULL == (p = ffvec_pushT(&m->toc_offsets, ffuint)))
+		return;
+	*p = m->nbytes;
+}
+
 /**
 Return enum MP3WRITE_R */
 /* .mp3 write algorithm:
@@ -112,7 +144,7 @@ Return enum MP3WRITE_R */
   . When MP3WRITE_FLAST is set: write the current frame and enter the ID3v1-writing state
   . When MP3WRITE_FLAMEFRAME is set: enter the ID3v1-writing state
 . Write ID3v1 tag
-. If MP3WRITE_XINGTAG is set: seek to the first frame, write Xing tag;  done
+. If MP3WRITE_XINGTAG is set: seek to the first frame, write Xing tag with TOC;  done
 . If MP3WRITE_FLAMEFRAME is set: seek to the first frame, write LAME frame
 */
 static inline int mp3write_process(mp3write *m, ffstr *input, ffstr *output, int flags)
@@ -189,6 +221,8 @@ static inline int mp3write_process(mp3write *m, ffstr *input, ffstr *output, int
 			if (input->len == 0)
 				return MP3WRITE_MORE;
 
+			if (m->options & MP3WRITE_XINGTAG)
+				_mp3w_toc_add(m);
 			*output = *input;
 			ffstr_shift(input, input->len);
 			m->nframes++;
@@ -235,11 +269,17 @@ static inline int mp3write_process(mp3write *m, ffstr *input, ffstr *output, int
 			return MP3WRITE_DATA;
 
 		case W_XING: {
+			ffuint hdr_size = mpeg1_size(m->frame1);
+			// the buffer may hold ID3v1 tag which is smaller than Xing frame
+			if (NULL == ffvec_realloc(&m->buf, hdr_size, 1))
+				return MP3WRITE_ERROR; // not enough memory
 			struct mpeg1_info info = {};
 			info.frames = m->nframes;
-			info.bytes = m->nbytes;
+			info.bytes = hdr_size + m->nbytes;
 			info.vbr_scale = m->vbr_scale;
-			ffmem_zero(m->buf.ptr, ffmin(m->buf.cap, 2048));
+			mpeg1_xing_toc(info.toc, (ffuint*)m->toc_offsets.ptr, m->toc_offsets.len, m->toc_interval
+				, m->nframes, info.bytes, hdr_size);
+			ffmem_zero(m->buf.ptr, hdr_size);
 			ffmem_copy(m->buf.ptr, m->frame1, 4);
 			r = mpeg1_xing_write(&info, m->buf.ptr);
 			ffstr_set(output, m->buf.ptr, r);
@@ -20,6 +20,7 @@ mp4read_offset
 #pragma once
 #include <avpack/decl.h>
 #include <avpack/base/mp4.h>
+#include <avpack/shared.h>
 #include <ffbase/stream.h>
 #include <ffbase/vector.h>
 
@@ -96,12 +97,18 @@ typedef struct mp4read {
 	ffuint tag; // enum MMTAG
 	ffstr tagval, tag_trktotal;
 	char tagbuf[32];
+	struct avpk_picture picture;
+
+	ffuint64 ilst_off; // File offset of "ilst" box
+	ffuint ilst_size; // Size of "ilst" box
+	ffuint ilst_free; // Size of "free" box right after "ilst"
 
 	mp4_log_t log;
 	void *udata;
 
 	ffuint itunes_smpb :1
 		, codec_conf_pending :1
+		, pic_ref :1 // User: return 'covr' tags with empty value and 'picture' describing the data; skip the data
 		;
 } mp4read;
 
@@ -137,6 +144,10 @@ enum MP4READ_R {
 	MP4READ_TAG = AVPK_META,
 };
 
+enum {
+	MP4READ_PIC_HDR_MAX = 1024, // Max size of picture data read in 'pic_ref' mode (to get image dimensions)
+};
+
 /** Get track meta info
 Return struct mp4read_audio_info | struct mp4read_video_info */
 static inline const void* mp4read_track_info(mp4read *m, int index)
@@ -226,6 +237,7 @@ static inline void mp4read_open2(mp4read *m, struct avpk_reader_conf *conf)
 	mp4read_open(m);
 	m->log = conf->log;
 	m->udata = conf->opaque;
+	m->pic_ref = !!(conf->flags & AVPKR_F_PICTURE_REF);
 }
 
 static inline void mp4read_close(mp4read *m)
@@ -264,7 +276,9 @@ static inline int _mp4_box_parse(mp4read *m, struct mp4_box *parent, struct mp4_
 	}
 	box->osize = sz;
 
-	int idx = mp4_box_find(parent->ctx, b->type);
+	int idx = (parent->ctx == mp4_ctx_ilst)
+		? mp4_ilst_box_find(b->type)
+		: mp4_box_find(parent->ctx, b->type);
 	if (idx != -1) {
 		const struct mp4_bbox *b = &parent->ctx[idx];
 		ffmem_copy(box->name, b->type, 4);
@@ -462,6 +476,16 @@ static inline int _mp4_box_process(mp4read *m, ffstr sbox)
 		m->curtrack->chunktab.len = r;
 		break;
 
+	case BOX_ILST:
+		m->ilst_off = m->off - ffstream_used(&m->stream);
+		m->ilst_size = box->osize;
+		break;
+
+	case BOX_FREE:
+		if (m->ilst_size != 0 && m->ilst_off + m->ilst_size == m->off - ffstream_used(&m->stream))
+			m->ilst_free = box->osize;
+		break;
+
 	case BOX_ILST_DATA: {
 		const struct mp4_box *parent = &m->boxes[m->ictx - 1];
 		r = mp4_ilst_data_read(sbox.ptr, sbox.len, MP4_GET_TYPE(parent->type) - _BOX_TAG, &m->tagval, m->tagbuf, sizeof(m->tagbuf));
@@ -470,6 +494,20 @@ static inline int _mp4_box_process(mp4read *m, ffstr sbox)
 
 		m->tag = r;
 		rc = MP4READ_TAG;
+
+		if (r == MMTAG_PICTURE && m->pic_ref) {
+			struct avpk_picture *p = &m->picture;
+			ffmem_zero_obj(p);
+			p->offset = m->off - ffstream_used(&m->stream) + box->osize - box->size + sizeof(struct mp4_ilst_data);
+			p->size = box->size - sizeof(struct mp4_ilst_data);
+			p->type = 3; // front cover
+			if (ffstr_matchz(&m->tagval, "\x89PNG"))
+				ffstr_setz(&p->mime, "image/png");
+			else if (ffstr_matchz(&m->tagval, "\xff\xd8"))
+				ffstr_setz(&p->mime, "image/jpeg");
+			_avpack_pic_dimensions(m->tagval, &p->width, &p->height);
+			ffstr_null(&m->tagval);
+		}
 		break;
 	}
 
@@ -600,8 +638,11 @@ static inline int mp4read_process(mp4read *m, ffstr *input, ffstr *output)
 				minsize += sizeof(struct mp4_fullbox);
 			if (box->size < minsize)
 				return _MP4R_ERR(m, MP4READ_ESIZE);
-			if (box->type & MP4_F_WHOLE)
+			if (box->type & MP4_F_WHOLE) {
 				minsize = box->size;
+				if (m->pic_ref && MP4_GET_TYPE(parent->type) == _BOX_TAG + MMTAG_PICTURE)
+					minsize = ffmin64(box->size, sizeof(struct mp4_ilst_data) + MP4READ_PIC_HDR_MAX); // the rest is skipped
+			}
 			if (minsize != 0) {
 				m->state = R_GATHER,  m->nextstate = R_BOXPROCESS,  m->gather_size += minsize;
 				continue;
@@ -770,6 +811,8 @@ static inline int mp4read_process2(mp4read *m, ffstr *input, union avpk_read_res
 		res->tag.id = m->tag;
 		ffstr_null(&res->tag.name);
 		res->tag.value = m->tagval;
+		if (m->tag == MMTAG_PICTURE && m->pic_ref)
+			res->tag.picture = m->picture;
 		break;
 
 	case AVPK_DATA:
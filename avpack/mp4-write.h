@@ -15,6 +15,7 @@ mp4write_process
 mp4write_error
 mp4write_finish
 mp4write_offset
+mp4write_ilst
 */
 
 #pragma once
@@ -198,6 +199,7 @@ static inline int mp4write_addtag(mp4write *m, ffuint mmtag, ffstr val)
 	}
 
 	if (mmtag == MMTAG_DISCNUMBER
+		|| mmtag == MMTAG_PICTURE // not implemented
 		|| NULL == mp4_ilst_find(mmtag))
 		return 1;
 
@@ -468,6 +470,84 @@ static inline ffuint64 mp4write_offset(mp4write *m)
 	return m->off;
 }
 
+/** Get tag data for "ilst" child box.
+Return NULL if there's no such tag */
+static const struct mp4_tag* _mp4w_ilst_tag(mp4write *m, ffuint t)
+{
+	if (t <= _BOX_TAG)
+		return NULL;
+	if (t == _BOX_TAG + MMTAG_TRACKNO)
+		return (m->trkn.num != 0 || m->trkn.total != 0) ? (void*)&m->trkn : NULL;
+	return tags_find((void*)m->tags.ptr, m->tags.len, t - _BOX_TAG);
+}
+
+static char* _mp4w_fbox_str(char *p, const char *type, ffstr val)
+{
+	char *d = p + sizeof(struct mp4box);
+	ffmem_zero(d, sizeof(struct mp4_fullbox));
+	ffmem_copy(d + sizeof(struct mp4_fullbox), val.ptr, val.len);
+	return p + mp4_fbox_write(type, p, val.len);
+}
+
+/** Write the complete "ilst" box with the tags added by mp4write_addtag().
+Used for in-place tag rewrite, without the rest of the file.
+iTunSMPB is written if 'info.total_samples' is set.
+Return 0 on success */
+static inline int mp4write_ilst(mp4write *m, ffvec *out)
+{
+	const ffuint hdr = sizeof(struct mp4box);
+	const struct mp4_bbox *b;
+	const struct mp4_tag *t;
+	ffsize n = hdr;
+
+	for (b = mp4_ctx_ilst;  ;  b++) {
+		if (NULL != (t = _mp4w_ilst_tag(m, MP4_GET_TYPE(b->flags)))) {
+			n += hdr + hdr + ((t->id == MMTAG_TRACKNO)
+				? mp4_ilst_trkn_data_write(NULL, 0, 0)
+				: mp4_ilst_data_write(NULL, &t->val));
+		}
+		if (b->flags & MP4_F_LAST)
+			break;
+	}
+
+	if (m->info.total_samples != 0)
+		n += hdr
+			+ hdr + sizeof(struct mp4_fullbox) + FFS_LEN("com.apple.iTunes")
+			+ hdr + sizeof(struct mp4_fullbox) + FFS_LEN("iTunSMPB")
+			+ hdr + mp4_itunes_smpb_write(NULL, 0, 0, 0);
+
+	if (NULL == ffvec_grow(out, n, 1))
+		return -1;
+	char *ilst = ffslice_end(out, 1), *p = ilst + hdr, *box;
+
+	for (b = mp4_ctx_ilst;  ;  b++) {
+		if (NULL != (t = _mp4w_ilst_tag(m, MP4_GET_TYPE(b->flags)))) {
+			box = p;
+			p += hdr + hdr;
+			p += (t->id == MMTAG_TRACKNO)
+				? mp4_ilst_trkn_data_write(p, m->trkn.num, m->trkn.total)
+				: mp4_ilst_data_write(p, &t->val);
+			mp4_box_write("data", box + hdr, p - box - hdr - hdr);
+			mp4_box_write(b->type, box, p - box - hdr);
+		}
+		if (b->flags & MP4_F_LAST)
+			break;
+	}
+
+	if (m->info.total_samples != 0) {
+		box = p;
+		p += hdr;
+		p = _mp4w_fbox_str(p, "mean", FFSTR_Z("com.apple.iTunes"));
+		p = _mp4w_fbox_str(p, "name", FFSTR_Z("iTunSMPB"));
+		p += mp4_box_write("data", p, mp4_itunes_smpb_write(p + hdr, m->info.total_samples, m->info.enc_delay, m->info.end_padding));
+		mp4_box_write("----", box, p - box - hdr);
+	}
+
+	mp4_box_write("ilst", ilst, p - ilst - hdr);
+	out->len += p - ilst;
+	return 0;
+}
+
 /**
 Return enum MP4WRITE_R */
 /* MP4 writing algorithm:
@@ -7,6 +7,7 @@
 mpcread_open mpcread_close
 mpcread_process
 mpcread_seek
+mpcread_tags_request
 mpcread_info
 mpcread_offset
 mpcread_tag
@@ -17,12 +18,13 @@ mpcread_cursample
 #pragma once
 #include <avpack/decl.h>
 #include <avpack/base/mpc.h>
-#include <avpack/apetag.h>
+#include <avpack/tailtag.h>
 #include <ffbase/vector.h>
 #include <avpack/shared.h>
 
 enum MPCREAD_O {
 	MPCREAD_O_NOTAGS = 1,
+	MPCREAD_O_DEFER_TAGS = 2, // don't seek before audio data; read tail tags after SE block or on mpcread_tags_request()
 };
 
 typedef void (*mpc_log_t)(void *udata, const char *fmt, va_list va);
@@ -46,13 +48,14 @@ typedef struct mpcread {
 
 	ffuint64 ST_off;
 	ffuint64 seek_sample;
+	ffuint64 resume_off; // where to continue after tail tags are read
 
 	char sh_block[4+1+8+8+2];
 	ffuint sh_block_len;
 	ffuint enc_profile;
 	ffbyte enc_ver[3];
 
-	struct apetagread apetag;
+	struct tailtagread tail;
 	ffstr tagname, tagval;
 	int tag;
 
@@ -60,6 +63,9 @@ typedef struct mpcread {
 	void *udata;
 
 	ffuint hdrok :1;
+	ffuint tags_pending :1; // tail tags are yet to be read
+	ffuint tags_request :1;
+	ffuint tags_eof :1; // finish after tail tags
 } mpcread;
 
 enum MPCREAD_R {
@@ -106,14 +112,19 @@ static inline void mpcread_open(mpcread *m, ffuint64 total_size)
 static inline void mpcread_open2(mpcread *m, struct avpk_reader_conf *conf)
 {
 	mpcread_open(m, !(conf->flags & AVPKR_F_NO_SEEK) ? conf->total_size : 0);
+	m->tail.id3v1.codepage = conf->code_page;
+	m->tail.codepage = conf->code_page;
+	m->tail.window = conf->tail_size;
 	m->log = conf->log;
 	m->udata = conf->opaque;
+	if (conf->flags & AVPKR_F_DEFER_TAGS)
+		m->options |= MPCREAD_O_DEFER_TAGS;
 }
 
 static inline void mpcread_close(mpcread *m)
 {
 	ffvec_free(&m->buf);
-	apetagread_close(&m->apetag);
+	tailtagread_close(&m->tail);
 }
 
 static int _mpcr_block_id(const char *name)
@@ -205,10 +216,14 @@ Return enum MPCREAD_R */
 . Gather and process or skip block body until the first AP block is met
 . Store ST block offset from SO block
 . Return SH block body (MPCREAD_HEADER)
-. Seek to ST block (MPCREAD_SEEK); parse it
-. Seek to the end and parse APE tag (MPCREAD_SEEK, MPCREAD_TAG)
+. Seek to the end and parse APE, Lyrics3, ID3v1 tags (MPCREAD_SEEK, MPCREAD_TAG)
 . Seek to audio data (MPCREAD_SEEK)
 . Gather and return AP blocks until SE block is met (MPCREAD_DATA)
+
+MPCREAD_O_DEFER_TAGS or no 'total_size':
+. Return SH block body (MPCREAD_HEADER)
+. Gather and return AP blocks, starting with the current one, until SE block is met (MPCREAD_DATA)
+. Seek to the end and parse tags (MPCREAD_SEEK, MPCREAD_TAG), if tags are enabled
 */
 static inline int mpcread_process(mpcread *m, ffstr *input, ffstr *output)
 {
@@ -216,7 +231,7 @@ static inline int mpcread_process(mpcread *m, ffstr *input, ffstr *output)
 		R_START, R_GATHER, R_GATHER_MORE,
 		R_HDR, R_NXTBLOCK, R_BLOCK_HDR, R_BLOCK_SKIP,
 		R_AP_FIND,
-		R_APETAG_SEEK, R_APETAG_FTR, R_APETAG, R_TAG_DONE,
+		R_TAILTAG_OPEN, R_TAILTAG, R_TAG_DONE,
 
 		// keep in sync with block_ids[]
 		R_AP = 0x100,
@@ -226,7 +241,7 @@ static inline int mpcread_process(mpcread *m, ffstr *input, ffstr *output)
 		R_SO,
 		R_ST,
 	};
-	const unsigned BLKHDR_MINSIZE = 2+1,  BLKHDR_MAXSIZE = 2+8,  TAGS_CHUNK_LEN = 1000,
+	const unsigned BLKHDR_MINSIZE = 2+1,  BLKHDR_MAXSIZE = 2+8,
 		MAX_BLOCK = 1*1024*1024;
 	int r;
 
@@ -289,6 +304,14 @@ static inline int mpcread_process(mpcread *m, ffstr *input, ffstr *output)
 		case R_NXTBLOCK:
 			if (m->buf.len != 0)
 				ffstr_erase_left((ffstr*)&m->buf, ffmin(m->buf.len, m->blk_size));
+
+			if (m->tags_request && m->tags_pending) {
+				m->tags_pending = 0;
+				m->resume_off = m->off - m->buf.len;
+				m->state = R_TAILTAG_OPEN;
+				continue;
+			}
+
 			m->state = R_GATHER,  m->nextstate = R_BLOCK_HDR,  m->gather_size = BLKHDR_MINSIZE;
 			continue;
 
@@ -346,6 +369,12 @@ static inline int mpcread_process(mpcread *m, ffstr *input, ffstr *output)
 					m->state = R_GATHER_MORE,  m->nextstate = r,  m->gather_size = m->blk_size;
 					break;
 				case R_SE:
+					if (m->tags_pending) {
+						m->tags_pending = 0;
+						m->tags_eof = 1;
+						m->state = R_TAILTAG_OPEN;
+						break;
+					}
 					return MPCREAD_DONE;
 				case R_ST:
 					m->state = R_BLOCK_SKIP;
@@ -364,7 +393,15 @@ static inline int mpcread_process(mpcread *m, ffstr *input, ffstr *output)
 
 				m->dataoff = m->blk_off;
 				m->hdrok = 1;
-				m->state = R_APETAG_SEEK;
+				m->resume_off = m->dataoff;
+				m->state = R_TAILTAG_OPEN;
+
+				if ((m->options & (MPCREAD_O_NOTAGS | MPCREAD_O_DEFER_TAGS))
+					|| m->total_size == 0) {
+					// continue with the current AP block
+					m->tags_pending = !(m->options & MPCREAD_O_NOTAGS) && m->total_size != 0;
+					m->state = R_GATHER_MORE,  m->nextstate = r,  m->gather_size = m->blk_size;
+				}
 
 				ffstr_set(output, m->sh_block, m->sh_block_len);
 				return MPCREAD_HEADER;
@@ -445,65 +482,49 @@ static inline int mpcread_process(mpcread *m, ffstr *input, ffstr *output)
 			continue;
 
 
-		case R_APETAG_SEEK: {
+		case R_TAILTAG_OPEN:
 			if ((m->options & MPCREAD_O_NOTAGS)
 				|| m->total_size == 0) {
 				m->state = R_TAG_DONE;
 				break;
 			}
 
-			ffuint64 n = ffmin64(m->total_size, TAGS_CHUNK_LEN);
-			m->off = m->total_size - n;
-			m->state = R_GATHER,  m->nextstate = R_APETAG_FTR,  m->gather_size = n;
-			m->buf.len = 0;
-			return MPCREAD_SEEK;
-		}
-
-		case R_APETAG_FTR: {
-			apetagread_open(&m->apetag);
-			ffint64 seek;
-			r = apetagread_footer(&m->apetag, m->chunk, &seek);
-			switch (r) {
-			case APETAGREAD_SEEK:
-				m->off += seek;
-				m->total_size = m->off;
-				m->state = R_APETAG;
-				return MPCREAD_SEEK;
-			default:
-				m->state = R_TAG_DONE;
-				break;
-			}
-			break;
-		}
+			tailtagread_open(&m->tail, m->total_size);
+			m->tail.min_off = m->dataoff;
+			m->state = R_TAILTAG;
+			// fallthrough
 
-		case R_APETAG: {
-			ffsize len = input->len;
-			r = apetagread_process(&m->apetag, input, &m->tagname, &m->tagval);
-			m->off += len - input->len;
+		case R_TAILTAG:
+			r = tailtagread_process(&m->tail, input, &m->tagname, &m->tagval);
 
 			switch (r) {
-			case APETAGREAD_DONE:
-				apetagread_close(&m->apetag);
-				m->state = R_TAG_DONE;
-				break;
+			case TAILTAGREAD_SEEK:
+				m->off = tailtagread_offset(&m->tail);
+				return MPCREAD_SEEK;
 
-			case APETAGREAD_MORE:
+			case TAILTAGREAD_MORE:
 				return MPCREAD_MORE;
 
-			case APETAGREAD_ERROR:
+			case TAILTAGREAD_WARN:
+				return _MPCR_WARN(m, tailtagread_error(&m->tail));
+
+			case TAILTAGREAD_DONE:
+				m->total_size = m->tail.total_size;
+				tailtagread_close(&m->tail);
 				m->state = R_TAG_DONE;
-				return _MPCR_WARN(m, "bad APE tag");
+				break;
 
 			default:
 				m->tag = -r;
 				return MPCREAD_TAG;
 			}
 			break;
-		}
 
 		case R_TAG_DONE:
+			if (m->tags_eof)
+				return MPCREAD_DONE;
 			m->buf.len = 0;
-			m->off = m->dataoff;
+			m->off = m->resume_off;
 			m->state = R_NXTBLOCK;
 			return MPCREAD_SEEK;
 		}
@@ -567,6 +588,12 @@ static inline void mpcread_seek(mpcread *m, ffuint64 sample)
 	m->seek_sample = sample;
 }
 
+/** MPCREAD_O_DEFER_TAGS: read tail tags at the next block boundary, then continue with audio */
+static inline void mpcread_tags_request(mpcread *m)
+{
+	m->tags_request = 1;
+}
+
 /**
 Return enum MMTAG */
 static inline int mpcread_tag(mpcread *m, ffstr *name, ffstr *val)
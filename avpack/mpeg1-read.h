@@ -18,6 +18,7 @@ mpeg1read_cursample
 #include <avpack/base/mpeg1.h>
 #include <ffbase/string.h>
 #include <ffbase/stream.h>
+#include <ffbase/vector.h>
 
 struct mpeg1read_info {
 	ffuint layer; // 1..3
@@ -41,21 +42,47 @@ typedef struct mpeg1read {
 	ffbyte prev_hdr[4];
 	ffuint hdr :1;
 	ffuint unrecognized_data :1;
+	ffuint index_exact :1; // 'cur_sample' is exact: the frames are counted from the beginning
+	ffuint index_scan_failed :1;
+	ffuint scan_duration :1;
+
+	/** Exact seek index: frame offset for every Nth frame (N = 'index_interval').
+	Filled while the frames are read normally;
+	 a seek request beyond the indexed region hops over the frame headers up to the target frame. */
+	ffvec index; // ffuint64[]
+	ffuint index_interval; // User may set it to enable the seek index.  0:disabled
+	ffuint64 scan_frame, seek_frame;
+	ffuint64 skip;
+	ffbyte scan_hdr[4];
+	ffuint scan_hdr_len;
 
 	struct mpeg1read_info info;
 	ffuint64 total_size;
+	ffuint options; // enum MPEG1READ_OPT
 } mpeg1read;
 
+enum {
+	MPEG1READ_INDEX_INTERVAL = 8, // recommended value for 'index_interval'
+};
+
+enum MPEG1READ_OPT {
+	/** Get the exact duration by hopping over all frame headers when there's no Xing/VBRI tag.
+	Frame data isn't copied: with the whole file as input it's just pointer arithmetic. */
+	MPEG1READ_OPT_SCAN = 1,
+};
+
 static inline void mpeg1read_open(mpeg1read *m, ffuint64 total_size)
 {
 	m->seek_sample = (ffuint64)-1;
 	m->total_size = total_size;
+	m->index_exact = 1;
 	ffstream_realloc(&m->stream, 4096);
 }
 
 static inline void mpeg1read_close(mpeg1read *m)
 {
 	ffstream_free(&m->stream);
+	ffvec_free(&m->index);
 }
 
 enum MPEG1READ_R {
@@ -177,6 +204,52 @@ static ffint64 _mpeg1r_seek_offset(mpeg1read *m, ffuint64 target)
 	return m->frame1_off + off;
 }
 
+/** Add frame offset to the seek index if it's the next Nth frame */
+static void _mpeg1r_index_add(mpeg1read *m, ffuint64 frame, ffuint64 off)
+{
+	if (m->index_interval == 0
+		|| frame != (ffuint64)m->index.len * m->index_interval)
+		return;
+	ffuint64 *p;
+	if (NULL == (p = ffvec_pushT(&m->index, ffuint64)))
+		return;
+	*p = off;
+}
+
+/** Set the file offset for the seek target using the frame index
+Return 0: the index can't be used;
+ 1: seek to the indexed frame;
+ 2: seek to the last indexed frame and scan from there */
+static int _mpeg1r_index_seek(mpeg1read *m)
+{
+	if (m->index.len == 0)
+		return 0;
+
+	int r = 1;
+	ffuint64 frame = m->seek_sample / mpeg1_samples(m->prev_hdr);
+	ffuint64 i = frame / m->index_interval;
+	if (i >= m->index.len) {
+		if (m->index_scan_failed || m->total_size == 0)
+			return 0;
+
+		i = m->index.len - 1;
+		m->scan_frame = i * m->index_interval;
+		m->seek_frame = frame;
+		m->skip = 0;
+		m->scan_hdr_len = 0;
+		r = 2;
+
+	} else {
+		m->cur_sample = i * m->index_interval * mpeg1_samples(m->prev_hdr);
+		m->seek_sample = (ffuint64)-1;
+	}
+
+	m->off = *ffslice_itemT(&m->index, i, ffuint64);
+	m->index_exact = 1;
+	ffstream_reset(&m->stream);
+	return r;
+}
+
 /**
 Return enum MPEG1READ_R */
 /* MPEG read alrogithm:
@@ -190,7 +263,7 @@ static inline int mpeg1read_process(mpeg1read *m, ffstr *input, ffstr *output)
 		R_HDR_FIND, R_HDR2,
 		R_HDR,
 		R_FRAME, R_FRAME_NEXT,
-		R_GATHER,
+		R_GATHER, R_SCAN, R_SCAN_FIN, R_SCAN_HDR,
 	};
 	int r;
 	const void *h;
@@ -207,6 +280,97 @@ static inline int mpeg1read_process(mpeg1read *m, ffstr *input, ffstr *output)
 			m->state = m->nextstate;
 			continue;
 
+		case R_SCAN: {
+			if (input->len == 0) {
+				if (m->total_size == 0
+					|| m->off < m->total_size)
+					return MPEG1READ_MORE;
+
+				if (m->scan_duration) {
+					m->state = R_SCAN_FIN;
+					continue;
+				}
+				// the target frame is beyond the last one: fall back to the estimated offset
+				m->index_scan_failed = 1;
+				m->state = R_FRAME;
+				continue;
+			}
+
+			// skip frame data without copying
+			if (m->skip != 0) {
+				ffsize n = ffmin64(m->skip, input->len);
+				ffstr_shift(input, n);
+				m->off += n;
+				m->skip -= n;
+				if (m->skip != 0)
+					continue;
+			}
+
+			h = input->ptr;
+			if (m->scan_hdr_len != 0 || input->len < 4) {
+				ffsize n = ffmin(4 - m->scan_hdr_len, input->len);
+				ffmem_copy(&m->scan_hdr[m->scan_hdr_len], input->ptr, n);
+				m->scan_hdr_len += n;
+				ffstr_shift(input, n);
+				m->off += n;
+				if (m->scan_hdr_len < 4)
+					continue;
+				h = m->scan_hdr;
+			}
+
+			if (!(mpeg1_valid(h)
+				&& mpeg1_match(h, m->prev_hdr))) {
+				if (m->scan_duration) {
+					// trailing data
+					m->state = R_SCAN_FIN;
+					continue;
+				}
+				// lost sync: fall back to the estimated offset
+				m->index_scan_failed = 1;
+				m->state = R_FRAME;
+				continue;
+			}
+
+			_mpeg1r_index_add(m, m->scan_frame, m->off - m->scan_hdr_len);
+
+			if (m->scan_frame == m->seek_frame) {
+				// continue reading frames from here
+				m->cur_sample = m->scan_frame * mpeg1_samples(h);
+				m->seek_sample = (ffuint64)-1;
+				m->state = R_GATHER,  m->nextstate = R_HDR,  m->gather_size = 4;
+				if (m->scan_hdr_len != 0) {
+					ffstr s = FFSTR_INITN(m->scan_hdr, 4);
+					ffstream_gather(&m->stream, s, 4, &m->chunk);
+					m->scan_hdr_len = 0;
+				}
+				continue;
+			}
+
+			m->skip = mpeg1_size(h) - m->scan_hdr_len;
+			m->scan_hdr_len = 0;
+			m->scan_frame++;
+			continue;
+		}
+
+		case R_SCAN_FIN: {
+			// the scan stopped at the end of the last frame: trailing tags aren't counted
+			ffuint64 end = m->off - m->scan_hdr_len;
+			m->scan_duration = 0;
+			m->info.total_samples = m->scan_frame * mpeg1_samples(m->prev_hdr);
+			if (m->info.total_samples != 0)
+				m->info.bitrate = (end - m->frame1_off) * 8 * m->info.sample_rate / m->info.total_samples;
+			m->scan_hdr_len = 0;
+			m->off = m->frame1_off;
+			ffstream_reset(&m->stream);
+			m->state = R_SCAN_HDR;
+			return MPEG1READ_SEEK;
+		}
+
+		case R_SCAN_HDR:
+			m->state = R_GATHER,  m->nextstate = R_HDR,  m->gather_size = 4;
+			ffstr_null(output);
+			return MPEG1READ_HEADER;
+
 		case R_HDR_FIND:
 			r = _mpeg1read_hdr_find(m, input, &m->chunk);
 			if (r == 0xfeed)
@@ -236,12 +400,26 @@ static inline int mpeg1read_process(mpeg1read *m, ffstr *input, ffstr *output)
 				r = _mpeg1read_info(m, m->chunk, r);
 				m->frame1_off = m->off - m->chunk.len + r;
 				ffmem_copy(m->prev_hdr, m->chunk.ptr, 4);
+				_mpeg1r_index_add(m, 0, m->frame1_off);
 				m->frame_off = m->off - ffstream_used(&m->stream);
 				if (r != 0) {
 					// skip and return Xing tag
 					ffstr_set(output, m->chunk.ptr, r);
 					ffstr_shift(&m->chunk, r);
 					ffstream_consume(&m->stream, r);
+
+				} else if ((m->options & MPEG1READ_OPT_SCAN)
+					&& m->total_size != 0) {
+					// count frames, then return to the first frame
+					m->scan_duration = 1;
+					m->scan_frame = 0;
+					m->seek_frame = (ffuint64)-1;
+					m->skip = 0;
+					m->scan_hdr_len = 0;
+					m->off = m->frame1_off;
+					ffstream_reset(&m->stream);
+					m->state = R_SCAN;
+					return MPEG1READ_SEEK;
 				}
 				return MPEG1READ_HEADER;
 			}
@@ -252,12 +430,21 @@ static inline int mpeg1read_process(mpeg1read *m, ffstr *input, ffstr *output)
 		case R_HDR:
 		case R_FRAME:
 			if (m->seek_sample != (ffuint64)-1) {
+				if (m->index_interval != 0
+					&& 0 != (r = _mpeg1r_index_seek(m))) {
+					m->state = R_GATHER,  m->nextstate = R_HDR,  m->gather_size = 4;
+					if (r == 2)
+						m->state = R_SCAN;
+					return MPEG1READ_SEEK;
+				}
+
 				ffint64 off;
 				if (-1 == (off = _mpeg1r_seek_offset(m, m->seek_sample)))
 					return _MPEG1R_ERR(m, "can't seek");
 				m->off = off;
 				m->cur_sample = m->seek_sample;
 				m->seek_sample = (ffuint64)-1;
+				m->index_exact = 0;
 				ffstream_reset(&m->stream);
 				m->state = R_HDR_FIND;
 				return MPEG1READ_SEEK;
@@ -279,6 +466,8 @@ static inline int mpeg1read_process(mpeg1read *m, ffstr *input, ffstr *output)
 		// case R_FRAME:
 			ffstr_set(output, m->chunk.ptr, m->gather_size);
 			m->frame_off = m->off - ffstream_used(&m->stream);
+			if (m->index_exact)
+				_mpeg1r_index_add(m, m->cur_sample / mpeg1_samples(m->prev_hdr), m->frame_off);
 			m->state = R_FRAME_NEXT;
 			return MPEG1READ_DATA;
 
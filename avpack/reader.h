@@ -11,6 +11,7 @@ avpk_seek
 #pragma once
 #include <avpack/decl.h>
 #include <avpack/vorbistag.h>
+#include <avpack/base/pcm.h>
 
 
 /** Get reader interface by file extension */
@@ -34,6 +35,15 @@ struct avpk_reader {
 	unsigned state;
 	unsigned ctx_alloc;
 	vorbistagread vtag;
+	unsigned vtag_last; // the current chunk is the last one of the tag block
+	unsigned vtag_skip; // skip the rest of the bad tag block
+
+	// planar PCM output
+	void **planar;
+	unsigned planar_cap;
+	unsigned channels, sample_size; // 0: planar output is disabled
+	ffuint64 planar_pos;
+	ffvec planar_tail; // incomplete frame at the end of data block
 };
 
 static inline int avpk_open(avpk_reader *a, const struct avpkr_if *rif, struct avpk_reader_conf *c)
@@ -48,6 +58,10 @@ static inline int avpk_open(avpk_reader *a, const struct avpkr_if *rif, struct a
 	}
 	a->ifa.open(a->ctx, c);
 	a->total_size = c->total_size;
+	if (c->planar != NULL && c->planar_cap != 0) {
+		a->planar = c->planar;
+		a->planar_cap = c->planar_cap;
+	}
 	return 0;
 }
 
@@ -57,12 +71,15 @@ static inline void avpk_close(avpk_reader *a)
 		a->ifa.close(a->ctx);
 	if (a->ctx_alloc)
 		ffmem_free(a->ctx);
+	vorbistagread_close(&a->vtag);
+	ffvec_free(&a->planar_tail);
 }
 
 static inline int avpk_read(avpk_reader *a, ffstr *in, union avpk_read_result *res)
 {
 	enum {
 		I_VORBISTAG = 1,
+		I_PLANAR,
 	};
 
 	int r;
@@ -76,7 +93,61 @@ static inline int avpk_read(avpk_reader *a, ffstr *in, union avpk_read_result *r
 				return AVPK_META;
 			}
 			a->state = 0;
-			break;
+			if (r == VORBISTAGREAD_DONE
+				|| (r == VORBISTAGREAD_MORE && !a->vtag_last))
+				break;
+
+			a->vtag_skip = 1;
+			ffmem_zero_obj(res);
+			res->error.message = (r == VORBISTAGREAD_MORE) ? "incomplete Vorbis comment" : "bad Vorbis comment";
+			res->error.offset = ~0ULL;
+			return AVPK_WARNING;
+
+		case I_PLANAR: {
+			ffsize frame = a->channels * a->sample_size, n;
+			if (a->planar_tail.len != 0) {
+				// complete the frame split between data blocks
+				ffsize k = ffmin(frame - a->planar_tail.len, a->data.len);
+				ffmem_copy((char*)a->planar_tail.ptr + a->planar_tail.len, a->data.ptr, k);
+				a->planar_tail.len += k;
+				ffstr_shift(&a->data, k);
+				if (a->planar_tail.len != frame) {
+					a->state = 0;
+					break;
+				}
+				pcm_deinterleave(a->planar, a->planar_tail.ptr, a->channels, a->sample_size, 1);
+				a->planar_tail.len = 0;
+				n = 1;
+
+			} else {
+				n = ffmin(a->data.len / frame, a->planar_cap);
+				if (n == 0) {
+					if (a->data.len != 0) {
+						// keep the incomplete frame until the next data block
+						if (NULL == ffvec_alloc(&a->planar_tail, frame, 1)) {
+							ffmem_zero_obj(res);
+							res->error.message = "not enough memory";
+							return AVPK_ERROR;
+						}
+						ffmem_copy(a->planar_tail.ptr, a->data.ptr, a->data.len);
+						a->planar_tail.len = a->data.len;
+					}
+					a->state = 0;
+					break;
+				}
+				pcm_deinterleave(a->planar, a->data.ptr, a->channels, a->sample_size, n);
+				ffstr_shift(&a->data, n * frame);
+			}
+
+			res->frame.ptr = (char*)a->planar;
+			res->frame.len = n * a->sample_size;
+			res->frame.pos = a->planar_pos;
+			res->frame.end_pos = ~0ULL;
+			res->frame.duration = n;
+			if (a->planar_pos != ~0ULL)
+				a->planar_pos += n;
+			return AVPK_DATA;
+		}
 		}
 
 		ffmem_zero_obj(res);
@@ -85,10 +156,26 @@ static inline int avpk_read(avpk_reader *a, ffstr *in, union avpk_read_result *r
 		case AVPK_HEADER:
 			if (!res->hdr.real_bitrate && res->hdr.duration)
 				res->hdr.real_bitrate = a->total_size * 8 * res->hdr.sample_rate / res->hdr.duration;
+			a->channels = a->sample_size = 0;
+			a->planar_tail.len = 0;
+			if (a->planar != NULL && res->hdr.codec == AVPKC_PCM
+				&& res->hdr.channels != 0 && res->hdr.sample_bits % 8 == 0) {
+				a->channels = res->hdr.channels;
+				a->sample_size = res->hdr.sample_bits / 8;
+			}
 			break;
 
-		case AVPK_META:
 		case AVPK_DATA:
+			if (a->sample_size != 0) {
+				a->data = *(ffstr*)&res->frame;
+				if (a->planar_tail.len == 0)
+					a->planar_pos = res->frame.pos;
+				a->state = I_PLANAR;
+				continue;
+			}
+			break;
+
+		case AVPK_META:
 		case AVPK_SEEK:
 		case AVPK_MORE:
 		case AVPK_FIN:
@@ -100,6 +187,20 @@ static inline int avpk_read(avpk_reader *a, ffstr *in, union avpk_read_result *r
 			switch (a->ifa.format) {
 			case AVPKF_FLAC:
 			case AVPKF_OGG:
+				if (a->ifa.format == AVPKF_OGG) {
+					// the comment packet is always whole
+					res->frame.pos = 0;
+					res->frame.end_pos = res->frame.len;
+				}
+				if (res->frame.pos == 0) {
+					vorbistagread_reset(&a->vtag);
+					// FLAC: VORBIS_COMMENT block is passed to us in chunks
+					a->vtag.partial = (a->ifa.format == AVPKF_FLAC);
+					a->vtag_skip = 0;
+				}
+				if (a->vtag_skip)
+					continue;
+				a->vtag_last = (res->frame.pos + res->frame.len == res->frame.end_pos);
 				a->data = *(ffstr*)&res->frame;
 				a->state = I_VORBISTAG;
 				continue;
@@ -115,6 +216,10 @@ static inline int avpk_read(avpk_reader *a, ffstr *in, union avpk_read_result *r
 
 static inline void avpk_seek(avpk_reader *a, ffuint64 pos)
 {
+	if (a->sample_size != 0) {
+		a->state = 0; // drop the rest of deinterleaved data
+		a->planar_tail.len = 0;
+	}
 	if (a->ifa.seek)
 		a->ifa.seek(a->ctx, pos);
 }
@@ -0,0 +1,312 @@
+/** avpack: in-place tag rewrite planner
+2026, Simon Zolin
+*/
+
+/*
+avpk_retag_close
+flac_retag
+id3v2_retag
+mp4_retag
+*/
+
+/* Instead of writing a new file, the new tags are placed into the space
+ already occupied by the old tags and the padding after them.
+The result is the list of (offset, bytes) patches to apply to the existing file.
+If the new tags don't fit, the file must be rewritten completely.
+
+FLAC: VORBIS_COMMENT, PICTURE and PADDING blocks are replaced;
+ the other blocks stay at their offsets.
+ID3v2: the whole tag (including its padding) is replaced.
+MP4: "ilst" box and "free" box right after it are replaced;
+ sizes of the parent boxes stay the same.
+ The old "ilst" entries that the writer can't produce (e.g. "covr") are copied as is.
+*/
+
+#pragma once
+#include <avpack/base/flac.h>
+#include <avpack/id3v2.h>
+#include <avpack/mp4-write.h>
+#include <ffbase/vector.h>
+
+struct avpk_patch {
+	ffuint64 offset; // absolute file offset
+	ffstr data;
+};
+
+struct avpk_retag {
+	ffvec patches; // struct avpk_patch[]
+};
+
+static inline void avpk_retag_close(struct avpk_retag *r)
+{
+	struct avpk_patch *p;
+	FFSLICE_WALK(&r->patches, p) {
+		ffstr_free(&p->data);
+	}
+	ffvec_free(&r->patches);
+}
+
+/** Add a patch of 'n' bytes at 'off'.
+Return data buffer to fill */
+static char* _avpk_retag_add(struct avpk_retag *r, ffuint64 off, ffsize n)
+{
+	struct avpk_patch *p = ffvec_pushT(&r->patches, struct avpk_patch);
+	if (p == NULL)
+		return NULL;
+	p->offset = off;
+	ffstr_null(&p->data);
+	if (NULL == ffstr_alloc(&p->data, n)) {
+		r->patches.len--;
+		return NULL;
+	}
+	p->data.len = n;
+	return p->data.ptr;
+}
+
+
+struct flac_retag_block {
+	ffuint64 offset; // File offset of block header: flacread_meta_offset()
+	ffuint size; // Block body size: flacread_meta_size()
+	ffuint type; // enum FLAC_TYPE: flacread_meta_type()
+};
+
+/** Contiguous space of replaceable blocks */
+struct _flac_retag_hole {
+	ffuint64 offset;
+	ffuint size, used;
+	ffuint last; // contains the last meta block
+	ffuint padding_only; // consists of a single PADDING block
+	ffuint items; // bit-table of the new blocks placed here
+};
+
+/** Plan FLAC meta blocks rewrite.
+blocks: all meta blocks after STREAMINFO, in file order
+tags: new VORBIS_COMMENT block body (vorbistagwrite_fin())
+pics: new PICTURE block bodies;  NULL: keep the existing PICTURE blocks
+Return 0: 'r->patches' is ready
+  >0: the new blocks don't fit into the existing space
+  <0: error */
+static inline int flac_retag(struct avpk_retag *r, const struct flac_retag_block *blocks, ffsize n, ffstr tags, const ffstr *pics, ffuint npics)
+{
+	const ffuint HDR = sizeof(struct flac_hdr);
+	struct _flac_retag_hole holes[32], *h = NULL;
+	ffuint nholes = 0;
+
+	if (pics == NULL)
+		npics = 0;
+	if (1 + npics > 32)
+		return -1;
+
+	for (ffsize i = 0;  i != n;  i++) {
+		const struct flac_retag_block *b = &blocks[i];
+		if (i != 0 && b->offset != blocks[i - 1].offset + HDR + blocks[i - 1].size)
+			return -1; // blocks must be contiguous
+
+		int replace = (b->type == FLAC_TTAGS || b->type == FLAC_TPADDING
+			|| (b->type == FLAC_TPIC && pics != NULL));
+		if (!replace) {
+			h = NULL;
+			continue;
+		}
+
+		if (h == NULL) {
+			if (nholes == FF_COUNT(holes))
+				return -1;
+			h = &holes[nholes++];
+			ffmem_zero_obj(h);
+			h->offset = b->offset;
+			h->padding_only = (b->type == FLAC_TPADDING);
+		} else {
+			h->padding_only = 0;
+		}
+		h->size += HDR + b->size;
+		h->last = (i == n - 1);
+	}
+
+	// Place the new blocks, the largest first.
+	// The remaining space in a hole must fit a PADDING block header, or be empty.
+	ffuint placed = 0;
+	for (ffuint k = 0;  k != 1 + npics;  k++) {
+		ffuint item = 0;
+		ffsize item_size = 0;
+		for (ffuint j = 0;  j != 1 + npics;  j++) {
+			ffsize sz = HDR + ((j == 0) ? tags.len : pics[j - 1].len);
+			if (!(placed & (1U << j)) && sz >= item_size) {
+				item = j;
+				item_size = sz;
+			}
+		}
+		placed |= 1U << item;
+
+		for (h = holes;  h != holes + nholes;  h++) {
+			ffsize rem = h->size - h->used;
+			if (rem == item_size || rem >= item_size + HDR)
+				break;
+		}
+		if (h == holes + nholes)
+			return 1;
+		h->used += item_size;
+		h->items |= 1U << item;
+	}
+
+	for (h = holes;  h != holes + nholes;  h++) {
+		if (h->items == 0 && h->padding_only)
+			continue; // not modified
+
+		char *p = _avpk_retag_add(r, h->offset, h->size);
+		if (p == NULL) {
+			avpk_retag_close(r);
+			return -1;
+		}
+		const char *end = p + h->size;
+
+		for (ffuint j = 0;  j != 1 + npics;  j++) {
+			if (!(h->items & (1U << j)))
+				continue;
+			ffstr d = (j == 0) ? tags : pics[j - 1];
+			ffuint last = h->last && (p + HDR + d.len == end);
+			p += flac_hdr_write(p, (j == 0) ? FLAC_TTAGS : FLAC_TPIC, last, d.len);
+			p = ffmem_copy(p, d.ptr, d.len);
+		}
+
+		if (p != end)
+			flac_padding_write(p, end - p - HDR, h->last);
+	}
+	return 0;
+}
+
+
+/** Plan ID3v2 tag rewrite.
+tag_size: total size of the existing tag at the beginning of file: id3v2read_size()
+w: new tag fields (id3v2write_add());  the tag is finalized here
+Return 0: 'r->patches' is ready
+  >0: the new tag doesn't fit into the existing space
+  <0: error */
+static inline int id3v2_retag(struct avpk_retag *r, ffuint tag_size, struct id3v2write *w)
+{
+	if (0 != id3v2write_finish(w, 0))
+		return -1;
+	if (w->buf.len > tag_size)
+		return 1;
+
+	char *p = _avpk_retag_add(r, 0, tag_size);
+	if (p == NULL)
+		return -1;
+	// fill the rest with padding
+	ffmem_copy(p, w->buf.ptr, w->buf.len);
+	ffmem_zero(p + w->buf.len, tag_size - w->buf.len);
+	id3v2_hdr_write(p, tag_size - sizeof(struct id3v2_taghdr));
+	return 0;
+}
+
+
+/** Get the next child box from 'data'.
+Return 0: 'box' is set;  1: no more data;  -1: bad box */
+static int _mp4_retag_box_next(ffstr *data, ffstr *box)
+{
+	if (data->len == 0)
+		return 1;
+	if (data->len < sizeof(struct mp4box))
+		return -1;
+	ffuint n = ffint_be_cpu32_ptr(data->ptr);
+	if (n < sizeof(struct mp4box) || n > data->len)
+		return -1;
+	ffstr_set(box, data->ptr, n);
+	ffstr_shift(data, n);
+	return 0;
+}
+
+/** Get the value of "name" box inside iTunes "----" box */
+static ffstr _mp4_retag_itunes_name(ffstr box)
+{
+	const ffuint HDR = sizeof(struct mp4box) + sizeof(struct mp4_fullbox);
+	ffstr name = {}, b;
+	ffstr_shift(&box, sizeof(struct mp4box));
+	while (0 == _mp4_retag_box_next(&box, &b)) {
+		if (!ffmem_cmp(b.ptr + 4, "name", 4) && b.len >= HDR) {
+			ffstr_set(&name, b.ptr + HDR, b.len - HDR);
+			break;
+		}
+	}
+	return name;
+}
+
+/** Return 1 if the child box of the old "ilst" can't be reproduced by mp4write_ilst() */
+static int _mp4_retag_keep(ffstr box, ffstr ilst)
+{
+	if (!ffmem_cmp(box.ptr + 4, "----", 4)) {
+		// keep unless the new "ilst" has the iTunes box with the same name
+		ffstr name = _mp4_retag_itunes_name(box), b, n2;
+		ffstr_shift(&ilst, sizeof(struct mp4box));
+		while (0 == _mp4_retag_box_next(&ilst, &b)) {
+			if (!ffmem_cmp(b.ptr + 4, "----", 4)) {
+				n2 = _mp4_retag_itunes_name(b);
+				if (ffstr_eq(&name, n2.ptr, n2.len))
+					return 0;
+			}
+		}
+		return 1;
+	}
+
+	int i = mp4_box_find(mp4_ctx_ilst, box.ptr + 4);
+	if (i < 0)
+		return 1;
+	// "gnre" is not kept: the new genre is written as "\251gen"
+	ffuint tag = MP4_GET_TYPE(mp4_ctx_ilst[i].flags) - _BOX_TAG;
+	return (tag == 0
+		|| tag == MMTAG_PICTURE
+		|| tag == MMTAG_DISCNUMBER);
+}
+
+/** Plan MP4 "ilst" box rewrite.
+The child boxes of the old "ilst" that mp4write_addtag() doesn't support
+ ("covr", "disk", unknown boxes, iTunes boxes with other names)
+ are copied after the new tags.
+ilst_off: offset of the existing "ilst" box: mp4read.ilst_off
+old_ilst: the existing "ilst" box (mp4read.ilst_size bytes read from 'ilst_off')
+free_size: size of "free" box right after "ilst";  0: none: mp4read.ilst_free
+ilst: the new "ilst" box: mp4write_ilst()
+Return 0: 'r->patches' is ready
+  >0: the new box doesn't fit into the existing space, or the old box can't be parsed
+  <0: error */
+static inline int mp4_retag(struct avpk_retag *r, ffuint64 ilst_off, ffstr old_ilst, ffuint free_size, ffstr ilst)
+{
+	const ffuint HDR = sizeof(struct mp4box);
+	ffuint64 cap = (ffuint64)old_ilst.len + free_size;
+	ffstr d, box;
+	int e;
+	if (old_ilst.len < HDR || ilst.len < HDR)
+		return -1;
+
+	ffuint64 n = ilst.len;
+	d = old_ilst;
+	ffstr_shift(&d, HDR);
+	while (0 == (e = _mp4_retag_box_next(&d, &box))) {
+		if (_mp4_retag_keep(box, ilst))
+			n += box.len;
+	}
+	if (e < 0)
+		return 1;
+
+	if (!(n == cap || n + HDR <= cap))
+		return 1;
+
+	// "free" box data is not written: its contents don't matter
+	char *p = _avpk_retag_add(r, ilst_off, (n == cap) ? n : n + HDR);
+	if (p == NULL)
+		return -1;
+	char *p_ilst = p;
+	p = ffmem_copy(p, ilst.ptr, ilst.len);
+
+	d = old_ilst;
+	ffstr_shift(&d, HDR);
+	while (0 == _mp4_retag_box_next(&d, &box)) {
+		if (_mp4_retag_keep(box, ilst))
+			p = ffmem_copy(p, box.ptr, box.len);
+	}
+	mp4_box_write("ilst", p_ilst, n - HDR);
+
+	if (n != cap)
+		mp4_box_write("free", p, cap - n - HDR);
+	return 0;
+}
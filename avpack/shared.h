@@ -55,3 +55,38 @@ static inline ffssize _avpack_gather_trailer(ffvec *buf, ffstr in, ffsize total,
 	buf->len += n;
 	return in.len;
 }
+
+/** Get image dimensions from the beginning of PNG or JPEG data
+Return 0 on success */
+static inline int _avpack_pic_dimensions(ffstr d, ffuint *width, ffuint *height)
+{
+	const ffbyte *p = (ffbyte*)d.ptr;
+	if (d.len >= 24
+		&& !ffmem_cmp(p, "\x89PNG\r\n\x1a\n", 8)
+		&& !ffmem_cmp(p + 12, "IHDR", 4)) {
+		*width = ffint_be_cpu32_ptr(p + 16);
+		*height = ffint_be_cpu32_ptr(p + 20);
+		return 0;
+	}
+
+	if (d.len < 2 || p[0] != 0xff || p[1] != 0xd8)
+		return -1;
+
+	// JPEG: walk through markers until SOFn: FF Cn LEN[2] PRECISION[1] HEIGHT[2] WIDTH[2]
+	for (ffsize i = 2;  i + 9 <= d.len;  ) {
+		if (p[i] != 0xff)
+			return -1;
+		ffuint t = p[i + 1];
+		if (t == 0xff) {
+			i++; // fill byte
+			continue;
+		}
+		if (t >= 0xc0 && t <= 0xcf && t != 0xc4 && t != 0xc8 && t != 0xcc) {
+			*height = ffint_be_cpu16_ptr(p + i + 5);
+			*width = ffint_be_cpu16_ptr(p + i + 7);
+			return 0;
+		}
+		i += 2 + ffint_be_cpu16_ptr(p + i + 2);
+	}
+	return -1;
+}
@@ -0,0 +1,354 @@
+/** avpack: tags at the end of file (APETAG, Lyrics3, ID3v1)
+2026, Simon Zolin
+*/
+
+/*
+tailtagread_open tailtagread_close
+tailtagread_process
+tailtagread_error
+tailtagread_offset
+*/
+
+/* Tail tags:
+... [LYRICS3] [APETAG] [ID3v1]
+
+Lyrics3 v2:
+"LYRICSBEGIN" (ID[3] SIZE[5] DATA)... SIZE[6] "LYRICS200"
+Lyrics3 v1:
+"LYRICSBEGIN" DATA "LYRICSEND"
+*/
+
+#pragma once
+#include <avpack/id3v1.h>
+#include <avpack/apetag.h>
+#include <avpack/mmtag.h>
+#include <ffbase/vector.h>
+#include <ffbase/unicode.h>
+
+typedef struct tailtagread {
+	ffuint state;
+	const char *error;
+	ffvec buf;
+	ffvec text_buf;
+	ffstr data; // the unprocessed part of the tail data
+	ffstr chunk;
+	ffuint gather_size;
+
+	/** Max size of data read from the end of file.
+	Tags not fitting into this window require an additional seek. */
+	ffuint window;
+
+	/** Input: file size
+	Output: offset of the first tag (i.e. the end of audio data) */
+	ffuint64 total_size;
+
+	/** Don't read data before this offset (e.g. audio data start) */
+	ffuint64 min_off;
+
+	ffuint64 off;
+	ffuint codepage;
+	ffuint ape_done :1;
+
+	struct id3v1read id3v1;
+	struct apetagread apetag;
+} tailtagread;
+
+enum {
+	TAILTAGREAD_WINDOW = 64*1024,
+};
+
+static inline void tailtagread_open(tailtagread *t, ffuint64 total_size)
+{
+	t->total_size = total_size;
+	if (t->window == 0)
+		t->window = TAILTAGREAD_WINDOW;
+	t->window = ffmax(t->window, sizeof(struct apetaghdr) + sizeof(struct id3v1));
+	apetagread_open(&t->apetag);
+}
+
+static inline void tailtagread_close(tailtagread *t)
+{
+	ffvec_free(&t->buf);
+	ffvec_free(&t->text_buf);
+	apetagread_close(&t->apetag);
+}
+
+enum TAILTAGREAD_R {
+	TAILTAGREAD_MORE = 1, // need more input data
+	TAILTAGREAD_SEEK, // need input data at absolute file offset = tailtagread_offset()
+	TAILTAGREAD_DONE, // done reading; 'total_size' is the end of audio data
+	TAILTAGREAD_WARN,
+};
+
+static inline const char* tailtagread_error(tailtagread *t)
+{
+	return t->error;
+}
+
+#define tailtagread_offset(t)  ((t)->off)
+
+#define _TAILTAGREAD_WARN(t, e) \
+	(t)->error = (e),  TAILTAGREAD_WARN
+
+/** Find Lyrics3 tag at the end of data
+Return the size of the whole tag;
+ 0: not found */
+static ffsize _tailtagr_lyrics3_find(ffstr data, ffstr *fields, ffuint *v2)
+{
+	ffstr s;
+	if (data.len >= 6+9
+		&& !ffmem_cmp(&data.ptr[data.len - 9], "LYRICS200", 9)) {
+		// v2: the size of the fields + "LYRICSBEGIN"
+		ffuint n;
+		ffstr_set(&s, &data.ptr[data.len - 15], 6);
+		if (!ffstr_toint(&s, &n, FFS_INT32)
+			|| n < 11 || n + 15 > data.len
+			|| ffmem_cmp(&data.ptr[data.len - 15 - n], "LYRICSBEGIN", 11))
+			return 0;
+
+		ffstr_set(fields, &data.ptr[data.len - 15 - n + 11], n - 11);
+		*v2 = 1;
+		return n + 15;
+	}
+
+	if (data.len >= 11+9
+		&& !ffmem_cmp(&data.ptr[data.len - 9], "LYRICSEND", 9)) {
+		// v1: no size field; the text is limited to 5100 bytes
+		ffsize max = ffmin(data.len, 11 + 5100 + 9);
+		ffstr_set(&s, &data.ptr[data.len - max], max - 9);
+		ffssize r = ffstr_find(&s, "LYRICSBEGIN", 11);
+		if (r < 0)
+			return 0;
+
+		ffstr_set(fields, &s.ptr[r + 11], s.len - (r + 11));
+		*v2 = 0;
+		return max - r;
+	}
+
+	return 0;
+}
+
+/** Get next Lyrics3 v2 field
+Return enum MMTAG;
+ -1: no more fields */
+static int _tailtagr_lyrics3_field(ffstr *fields, ffstr *name, ffstr *val)
+{
+	static const char ids[][3] = {
+		"AUT",
+		"EAL",
+		"EAR",
+		"ETT",
+		"INF",
+		"LYR",
+	};
+	static const ffbyte tags[] = {
+		MMTAG_COMPOSER,
+		MMTAG_ALBUM,
+		MMTAG_ARTIST,
+		MMTAG_TITLE,
+		MMTAG_COMMENT,
+		MMTAG_LYRICS,
+	};
+
+	for (;;) {
+		ffuint n;
+		ffstr s;
+		if (fields->len < 3+5)
+			return -1;
+		ffstr_set(&s, &fields->ptr[3], 5);
+		if (!ffstr_toint(&s, &n, FFS_INT32)
+			|| 3+5 + n > fields->len)
+			return -1;
+
+		ffstr_set(name, fields->ptr, 3);
+		ffstr_set(val, &fields->ptr[3+5], n);
+		ffstr_shift(fields, 3+5 + n);
+
+		if (ffstr_eqcz(name, "IND"))
+			continue; // indications: not a text field
+
+		ffssize r = ffcharr_findsorted(ids, FF_COUNT(ids), 3, name->ptr, 3);
+		return (r >= 0) ? tags[r] : MMTAG_UNKNOWN;
+	}
+}
+
+/** Lyrics3 text is ISO-8859-1 or UTF-8 */
+static void _tailtagr_text(tailtagread *t, ffstr *val)
+{
+	ffssize n = ffutf8_from_utf8(NULL, 0, val->ptr, val->len, 0);
+	if (NULL == ffvec_realloc(&t->text_buf, n, 1))
+		return;
+	n = ffutf8_from_utf8(t->text_buf.ptr, t->text_buf.cap, val->ptr, val->len, 0);
+	if (n == (ffssize)val->len)
+		return; // valid UTF-8
+
+	ffuint cp = (t->codepage != 0) ? t->codepage : FFUNICODE_WIN1252;
+	n = ffutf8_from_cp(NULL, 0, val->ptr, val->len, cp);
+	if (NULL == ffvec_realloc(&t->text_buf, n, 1))
+		return;
+	n = ffutf8_from_cp(t->text_buf.ptr, t->text_buf.cap, val->ptr, val->len, cp);
+	if (n < 0)
+		n = 0;
+	ffstr_set(val, t->text_buf.ptr, n);
+}
+
+/** Read the tail of file once and parse all tags from it.
+Return >0: enum TAILTAGREAD_R
+ <=0: enum MMTAG */
+/* Algorithm:
+. Seek to the end of file minus 'window', gather data
+. Parse ID3v1 tag
+. Parse APE tag or Lyrics3 tag at the end of the remaining data; repeat
+. If APE tag begins before the window: seek to it and read it,
+   then read the window before it and search for Lyrics3 tag there */
+static inline int tailtagread_process(tailtagread *t, ffstr *input, ffstr *name, ffstr *val)
+{
+	enum {
+		R_INIT, R_GATHER, R_ID3V1, R_FTR,
+		R_APETAG, R_APETAG_SEEK, R_LYRICS3, R_DONE,
+	};
+	int r;
+
+	for (;;) {
+		switch (t->state) {
+		case R_INIT: {
+			ffuint64 n = 0;
+			if (t->total_size > t->min_off)
+				n = ffmin64(t->total_size - t->min_off, t->window);
+			if (n == 0) {
+				t->state = R_DONE;
+				continue;
+			}
+			t->off = t->total_size - n;
+			t->state = R_GATHER,  t->gather_size = n;
+			return TAILTAGREAD_SEEK;
+		}
+
+		case R_GATHER:
+			r = ffstr_gather((ffstr*)&t->buf, &t->buf.cap, input->ptr, input->len, t->gather_size, &t->data);
+			if (r < 0) {
+				t->state = R_DONE;
+				return _TAILTAGREAD_WARN(t, "not enough memory");
+			}
+			ffstr_shift(input, r);
+			t->off += r;
+			if (t->data.len == 0)
+				return TAILTAGREAD_MORE;
+			t->buf.len = 0;
+			if (t->ape_done) {
+				// the data before APE tag: only Lyrics3 tag may be here
+				t->state = R_FTR;
+				continue;
+			}
+			t->state = R_ID3V1;
+			// fallthrough
+
+		case R_ID3V1: {
+			if (sizeof(struct id3v1) > t->data.len) {
+				t->state = R_FTR;
+				continue;
+			}
+
+			ffstr id3;
+			ffstr_set(&id3, &t->data.ptr[t->data.len - sizeof(struct id3v1)], sizeof(struct id3v1));
+			r = id3v1read_process(&t->id3v1, id3, val);
+			switch (r) {
+			case ID3V1READ_DONE:
+				t->data.len -= sizeof(struct id3v1);
+				t->total_size -= sizeof(struct id3v1);
+				break;
+			case ID3V1READ_NO:
+				break;
+			default:
+				name->len = 0;
+				return r;
+			}
+			t->state = R_FTR;
+		}
+			// fallthrough
+
+		case R_FTR: {
+			ffint64 seek;
+			ffuint v2;
+			ffsize n;
+			if (!t->ape_done
+				&& APETAGREAD_SEEK == apetagread_footer(&t->apetag, t->data, &seek)) {
+				t->ape_done = 1;
+				t->total_size += seek;
+				if ((ffuint64)-seek > t->data.len) {
+					// the tag begins before the window
+					t->off = t->total_size;
+					t->state = R_APETAG_SEEK;
+					return TAILTAGREAD_SEEK;
+				}
+				ffstr_set(&t->chunk, &t->data.ptr[t->data.len + seek], -seek);
+				t->data.len += seek;
+				t->state = R_APETAG;
+				continue;
+
+			} else if (0 != (n = _tailtagr_lyrics3_find(t->data, &t->chunk, &v2))) {
+				t->total_size -= n;
+				t->data.len -= n;
+				t->state = R_LYRICS3;
+				if (!v2) {
+					ffstr_setz(name, "LYRICS");
+					*val = t->chunk;
+					t->chunk.len = 0;
+					_tailtagr_text(t, val);
+					return -MMTAG_LYRICS;
+				}
+				continue;
+			}
+
+			t->state = R_DONE;
+			continue;
+		}
+
+		case R_APETAG:
+			r = apetagread_process(&t->apetag, &t->chunk, name, val);
+			switch (r) {
+			case APETAGREAD_DONE:
+				t->state = R_FTR;
+				continue;
+			case APETAGREAD_MORE:
+				t->state = R_FTR;
+				return _TAILTAGREAD_WARN(t, "incomplete APE tag");
+			case APETAGREAD_ERROR:
+				t->state = R_FTR;
+				return _TAILTAGREAD_WARN(t, apetagread_error(&t->apetag));
+			}
+			return r;
+
+		case R_APETAG_SEEK: {
+			ffsize len = input->len;
+			r = apetagread_process(&t->apetag, input, name, val);
+			t->off += len - input->len;
+			switch (r) {
+			case APETAGREAD_MORE:
+				return TAILTAGREAD_MORE;
+			case APETAGREAD_DONE:
+				// read the data before APE tag to find Lyrics3 tag
+				t->state = R_INIT;
+				continue;
+			case APETAGREAD_ERROR:
+				t->state = R_DONE;
+				return _TAILTAGREAD_WARN(t, apetagread_error(&t->apetag));
+			}
+			return r;
+		}
+
+		case R_LYRICS3:
+			if (0 > (r = _tailtagr_lyrics3_field(&t->chunk, name, val))) {
+				t->state = R_FTR;
+				continue;
+			}
+			_tailtagr_text(t, val);
+			return -r;
+
+		case R_DONE:
+			return TAILTAGREAD_DONE;
+		}
+	}
+}
+
+#undef _TAILTAGREAD_WARN
@@ -5,6 +5,7 @@
 tsread_open
 tsread_close
 tsread_process
+tsread_seek
 tsread_info
 tsread_pos_msec
 tsread_offset
@@ -14,21 +15,50 @@ tsread_error
 #pragma once
 #include <avpack/decl.h>
 #include <avpack/base/ts.h>
+#include <avpack/base/adts.h>
+#include <avpack/base/mpeg1.h>
 #include <ffbase/stream.h>
-#include <ffbase/map.h>
 
 typedef void (*ts_log_t)(void *udata, const char *fmt, va_list va);
 
+enum TSREAD_OPT {
+	TSREAD_O_FRAMES = 1, // split AAC (ADTS) and MPEG audio PES payload into frames
+};
+
 typedef struct tsread {
 	ffuint gather;
 	ffuint n_pkt;
-	ffuint64 off;
-	ffmap pms; // pid => struct _tsr_pm*
+	ffuint64 off, total_size;
+	struct _tsr_pm **pids; // pid => struct _tsr_pm*
+	ffvec pms; // struct _tsr_pm*[]
 	struct _tsr_pm *cur;
-	ffstream stream;
+	ffstream stream; // packet data split between input buffers
 	struct ts_packet pkt;
 	const char *error;
 	ffuint sync :1;
+	ffuint keep :1; // don't consume the current packet
+	ffuint in_place :1; // the current packet is inside the input buffer
+	ffuint bulk_n; // N of packets in the input buffer with valid sync bytes
+	const char *bulk_ptr;
+	ffuint options; // enum TSREAD_OPT
+
+	struct _tsr_pm *pes_done; // PES whose buffer was returned to user
+	struct _tsr_pm *frames_pm;
+	ffstr frames; // PES payload not yet split into frames
+	ffuint64 pos_msec;
+
+	struct {
+		ffuint state; // enum _TSR_SEEK
+		ffuint pid;
+		ffuint64 pts_first; // PTS of the first PES
+		ffuint64 off_first; // offset of the first PES
+		ffuint64 end_msec; // position of the PES near the end of file
+		ffuint64 target;
+		ffuint64 off; // probe offset
+		ffuint64 lo_off, lo_msec, hi_off, hi_msec;
+		ffuint n;
+		ffuint ready :1;
+	} seek;
 
 	ts_log_t log;
 	void *udata;
@@ -45,39 +75,42 @@ static inline void _tsr_log(tsread *t, const char *fmt, ...)
 	va_end(va);
 }
 
-static int _tsr_pids_keyeq(void *opaque, const void *key, ffsize keylen, void *val)
-{
-	(void)opaque;
-	(void)keylen;
-	const struct _tsr_pm *pm = val;
-	ffuint pid = (ffsize)key;
-	return (pid == pm->pid);
-}
-
-static struct _tsr_pm* _tsr_pm_add_new(tsread *t, ffuint pid)
-{
-	struct _tsr_pm *pm = ffmem_new(struct _tsr_pm);
-	pm->pid = pid;
-	ffmap_add_hash(&t->pms, pid, pm);
-	return pm;
-}
+enum {
+	_TSR_PIDS = 8192,
+};
 
+/**
+Return NULL on error */
 static struct _tsr_pm* _tsr_pm_add(tsread *t, ffuint pid)
 {
-	struct _tsr_pm *pm = ffmap_find_hash(&t->pms, pid, (void*)(ffsize)pid, 4, NULL);
-	if (!pm)
-		pm = _tsr_pm_add_new(t, pid);
+	struct _tsr_pm *pm = t->pids[pid];
+	if (!pm) {
+		struct _tsr_pm **it = ffvec_pushT(&t->pms, struct _tsr_pm*);
+		if (it == NULL)
+			return NULL;
+		if (NULL == (pm = ffmem_new(struct _tsr_pm))) {
+			t->pms.len--;
+			return NULL;
+		}
+		pm->pid = pid;
+		*it = pm;
+		t->pids[pid] = pm;
+	}
 	return pm;
 }
 
+/** Note: on memory allocation error, tsread_process() returns TSREAD_ERROR */
 static inline void tsread_open(tsread *t, ffuint64 total_size)
 {
-	(void)total_size;
+	t->total_size = total_size;
 	t->gather = 188;
-	ffstream_realloc(&t->stream, 188);
+	ffstream_realloc(&t->stream, 188*2);
 
-	ffmap_init(&t->pms, _tsr_pids_keyeq);
-	_tsr_pm_add_new(t, 0);
+	t->pids = (struct _tsr_pm**)ffmem_calloc(_TSR_PIDS, sizeof(struct _tsr_pm*));
+	if (t->pids != NULL && NULL == _tsr_pm_add(t, 0)) {
+		ffmem_free(t->pids);
+		t->pids = NULL;
+	}
 }
 
 static inline void tsread_open2(tsread *t, struct avpk_reader_conf *conf)
@@ -89,13 +122,15 @@ static inline void tsread_open2(tsread *t, struct avpk_reader_conf *conf)
 
 static inline void tsread_close(tsread *t)
 {
-	struct _ffmap_item *it;
-	FFMAP_WALK(&t->pms, it) {
-		if (_ffmap_item_occupied(it))
-			continue;
-		ffmem_free(it->val);
+	struct _tsr_pm **it;
+	FFSLICE_WALK(&t->pms, it) {
+		struct _tsr_pm *pm = *it;
+		ffvec_free(&pm->buf);
+		ffvec_free(&pm->partial);
+		ffmem_free(pm);
 	}
-	ffmap_free(&t->pms);
+	ffvec_free(&t->pms);
+	ffmem_free(t->pids);  t->pids = NULL;
 	ffstream_free(&t->stream);
 }
 
@@ -104,6 +139,8 @@ enum TSREAD_R {
 	TSREAD_WARN = AVPK_WARNING,
 	TSREAD_MORE = AVPK_MORE,
 	TSREAD_DATA = AVPK_DATA,
+	TSREAD_DONE = AVPK_FIN,
+	TSREAD_SEEK = AVPK_SEEK, // need input data at offset tsread_seek_offset()
 };
 
 #define _TSR_ERR(t, e) \
@@ -114,19 +151,395 @@ static inline const char* tsread_error(tsread *t)
 	return t->error;
 }
 
-/** Process .ts data chunk.
-Return enum TSREAD_R */
-static inline int tsread_process(tsread *t, ffstr *input, ffstr *output)
+/** Get the size of audio frame
+Return frame size;
+ 0: need more data;
+ -1: bad header */
+static int _tsr_frame_size(struct _tsr_pm *pm, ffstr d, ffuint *samples, ffuint *rate)
+{
+	switch (pm->stream_type) {
+	case TS_STREAM_AUDIO_AAC: {
+		struct adts_hdr h;
+		if (d.len < 7)
+			return 0;
+		if (adts_hdr_read(&h, d.ptr, 7) <= 0)
+			return -1;
+		*samples = 1024;
+		*rate = h.sample_rate;
+		return h.framelen;
+	}
+
+	case TS_STREAM_AUDIO_MP3:
+		if (d.len < 4)
+			return 0;
+		if (!mpeg1_valid(d.ptr))
+			return -1;
+		*samples = mpeg1_samples(d.ptr);
+		*rate = mpeg1_sample_rate(d.ptr);
+		return mpeg1_size(d.ptr);
+	}
+	return -1;
+}
+
+static void _tsr_frame_pos(tsread *t, struct _tsr_pm *pm, ffuint samples, ffuint rate)
+{
+	t->pos_msec = pm->frame_base_msec + pm->frame_samples * 1000 / rate;
+	pm->frame_samples += samples;
+}
+
+/** Get next frame from PES payload.
+A frame that continues in the next PES is stored in 'partial' buffer.
+Return 0: no more frames;
+ enum TSREAD_R */
+static int _tsr_frame_next(tsread *t, ffstr *output)
 {
+	struct _tsr_pm *pm = t->frames_pm;
+	ffuint samples, rate;
+	int n;
+
+	if (pm->partial_out) {
+		pm->partial_out = 0;
+		pm->partial.len = 0;
+	}
+
+	while (pm->partial.len != 0) {
+		// complete the frame started in the previous PES
+		n = _tsr_frame_size(pm, *(ffstr*)&pm->partial, &samples, &rate);
+		if (n < 0) {
+			pm->partial.len = 0;
+			break;
+		}
+		ffsize need = (n != 0) ? (ffuint)n : 7;
+		ffsize k = ffmin(need - pm->partial.len, t->frames.len);
+		if (k != ffvec_add(&pm->partial, t->frames.ptr, k, 1))
+			return _TSR_ERR(t, "not enough memory");
+		ffstr_shift(&t->frames, k);
+		if (pm->partial.len < need) {
+			if (t->frames.len == 0) {
+				t->frames_pm = NULL;
+				return 0;
+			}
+			continue;
+		}
+		if (n == 0)
+			continue;
+
+		_tsr_frame_pos(t, pm, samples, rate);
+		ffstr_set(output, pm->partial.ptr, pm->partial.len);
+		pm->partial_out = 1;
+		return TSREAD_DATA;
+	}
+
+	if (t->frames.len == 0) {
+		t->frames_pm = NULL;
+		return 0;
+	}
+
+	n = _tsr_frame_size(pm, t->frames, &samples, &rate);
+	if (n < 0) {
+		// find the next frame
+		ffssize i = ffs_findchar(t->frames.ptr + 1, t->frames.len - 1, 0xff);
+		ffstr_shift(&t->frames, (i >= 0) ? (ffsize)i + 1 : t->frames.len);
+		t->error = "bad frame header";
+		return TSREAD_WARN;
+	}
+
+	if (n == 0 || (ffuint)n > t->frames.len) {
+		if (t->frames.len != ffvec_add(&pm->partial, t->frames.ptr, t->frames.len, 1))
+			return _TSR_ERR(t, "not enough memory");
+		t->frames.len = 0;
+		t->frames_pm = NULL;
+		return 0;
+	}
+
+	if (pm->pts_pending) {
+		// PTS applies to the first frame which starts in this PES
+		pm->pts_pending = 0;
+		pm->frame_base_msec = pm->pos_msec;
+		pm->frame_samples = 0;
+	}
+	_tsr_frame_pos(t, pm, samples, rate);
+	ffstr_set(output, t->frames.ptr, n);
+	ffstr_shift(&t->frames, n);
+	return TSREAD_DATA;
+}
+
+/** Get PES position (msec) relative to the first PES, considering PTS wraparound.
+PTS slightly behind the first one (e.g. in another stream) is position 0. */
+static ffuint64 _tsr_pos_msec(tsread *t, ffuint64 pts)
+{
+	ffuint64 d = (pts - t->seek.pts_first) & ((1ULL << 33) - 1);
+	if (d >= (1ULL << 32))
+		return 0;
+	return d / 90;
+}
+
+/** Return PES payload as a whole or split into frames */
+static int _tsr_pes_out(tsread *t, struct _tsr_pm *pm, ffstr data, ffstr *output)
+{
+	t->cur = pm;
+	if ((t->options & TSREAD_O_FRAMES)
+		&& (pm->stream_type == TS_STREAM_AUDIO_AAC || pm->stream_type == TS_STREAM_AUDIO_MP3)) {
+		t->frames = data;
+		t->frames_pm = pm;
+		pm->pts_pending = 1;
+		int r = _tsr_frame_next(t, output);
+		if (r == 0 && t->pes_done == pm) {
+			// the remaining data is in 'partial' buffer
+			pm->buf.len = 0;
+			t->pes_done = NULL;
+		}
+		return r;
+	}
+
+	*output = data;
+	t->pos_msec = pm->pos_msec;
+	return TSREAD_DATA;
+}
+
+/** Add packet data to PES.
+Set 'keep' flag if the packet must be processed again.
+Return 0: PES isn't complete yet;
+ enum TSREAD_R */
+static int _tsr_pes_add(tsread *t, struct _tsr_pm *pm, ffstr *output)
+{
+	ffstr body = t->pkt.body;
 	int r;
-	ffstr chunk = {};
+
+	if (t->pkt.start) {
+		if (pm->buf.len != 0) {
+			pm->pes_active = 0;
+			if (pm->pes_len != 0) {
+				pm->buf.len = 0;
+				t->keep = 1;
+				t->error = "incomplete PES packet";
+				return TSREAD_WARN;
+			}
+
+			// the previous PES has no length: it ends here
+			t->keep = 1;
+			t->pes_done = pm;
+			return _tsr_pes_out(t, pm, *(ffstr*)&pm->buf, output);
+		}
+
+		if (0 == (r = ts_data_hdr_read(pm, body))) {
+			t->error = "bad PES header";
+			return TSREAD_ERROR;
+		}
+		pm->pos_msec = _tsr_pos_msec(t, pm->pts);
+		_tsr_log(t, " stream_id:%xu  packet:%u  pos:%U"
+			, pm->stream_id, pm->pkt_len, pm->pos_msec);
+		ffstr_shift(&body, r);
+
+		// 'pkt_len' counts the bytes after its own field; it's at offset 5 in 'body'
+		pm->pes_len = 0;
+		if (pm->pkt_len + 5 > (ffuint)r)
+			pm->pes_len = pm->pkt_len + 5 - r;
+		pm->pes_active = 1;
+
+		if (pm->pes_len != 0 && body.len >= pm->pes_len
+			&& !(t->options & TSREAD_O_FRAMES)) {
+			// the whole PES is inside this packet
+			pm->pes_active = 0;
+			body.len = pm->pes_len;
+			return _tsr_pes_out(t, pm, body, output);
+		}
+
+	} else if (!pm->pes_active) {
+		return 0;
+	}
+
+	if (pm->pes_len != 0)
+		body.len = ffmin(body.len, pm->pes_len);
+	if (body.len != ffvec_add(&pm->buf, body.ptr, body.len, 1))
+		return _TSR_ERR(t, "not enough memory");
+
+	if (pm->pes_len != 0) {
+		pm->pes_len -= body.len;
+		if (pm->pes_len == 0) {
+			pm->pes_active = 0;
+			t->pes_done = pm;
+			return _tsr_pes_out(t, pm, *(ffstr*)&pm->buf, output);
+		}
+	}
+	return 0;
+}
+
+/** Return the data of PES without length at the end of file */
+static int _tsr_flush(tsread *t, ffstr *output)
+{
+	struct _tsr_pm **it;
+	FFSLICE_WALK(&t->pms, it) {
+		struct _tsr_pm *pm = *it;
+		if (pm->buf.len != 0 && pm->pes_len == 0) {
+			pm->pes_active = 0;
+			t->pes_done = pm;
+			return _tsr_pes_out(t, pm, *(ffstr*)&pm->buf, output);
+		}
+	}
+	return TSREAD_DONE;
+}
+
+enum _TSR_SEEK {
+	_TSR_SEEK_NONE,
+	_TSR_SEEK_START,
+	_TSR_SEEK_PROBE,
+};
+
+enum {
+	_TSR_SEEK_TAIL = 188*1024, // the size of file tail to search for the last PES
+	_TSR_SEEK_PRECISION = 188*256, // stop when the distance between 2 probes is smaller than this
+	_TSR_SEEK_MAX_PROBES = 16,
+};
+
+/** Drop all unfinished PES data */
+static void _tsr_pes_reset(tsread *t)
+{
+	struct _tsr_pm **it;
+	FFSLICE_WALK(&t->pms, it) {
+		struct _tsr_pm *pm = *it;
+		pm->buf.len = 0;
+		pm->partial.len = 0;
+		pm->partial_out = 0;
+		pm->pes_active = 0;
+	}
+	t->frames_pm = NULL;
+	t->pes_done = NULL;
+	t->bulk_n = 0;
+}
+
+/** Get the next probe offset or finish seeking
+Return TSREAD_SEEK;
+ 0: the current packet is the target */
+static int _tsr_seek_next(tsread *t, int lo_is_current)
+{
+	ffuint64 off;
+
+	if (t->seek.hi_msec == ~0ULL) {
+		// find the last PES to get the duration
+		off = (t->total_size > _TSR_SEEK_TAIL) ? t->total_size - _TSR_SEEK_TAIL : 0;
+		off = ffmax(off, t->seek.lo_off);
+
+	} else if (t->seek.hi_off - t->seek.lo_off <= _TSR_SEEK_PRECISION
+		|| t->seek.n == _TSR_SEEK_MAX_PROBES
+		|| t->seek.hi_msec <= t->seek.lo_msec) {
+		// done: start reading from the last PES before the target
+		_tsr_log(t, "seek: done in %u probes: offset:%xU  pos:%U"
+			, t->seek.n, t->seek.lo_off, t->seek.lo_msec);
+		t->seek.state = _TSR_SEEK_NONE;
+		_tsr_pes_reset(t);
+		if (lo_is_current)
+			return 0;
+		off = t->seek.lo_off;
+		goto seek;
+
+	} else {
+		// interpolate
+		off = t->seek.lo_off
+			+ (t->seek.target - t->seek.lo_msec) * (t->seek.hi_off - t->seek.lo_off)
+				/ (t->seek.hi_msec - t->seek.lo_msec);
+		off = ffmin(off, t->seek.hi_off - _TSR_SEEK_PRECISION / 2);
+		off = ffmax(off, t->seek.lo_off + 188);
+	}
+
+	t->seek.n++;
+	t->seek.off = off;
+	t->seek.state = _TSR_SEEK_PROBE;
+	_tsr_log(t, "seek: probe #%u  offset:%xU", t->seek.n, off);
+
+seek:
+	ffstream_reset(&t->stream);
+	t->bulk_n = 0;
+	t->sync = 0;
+	t->off = off;
+	return TSREAD_SEEK;
+}
+
+/** Handle probe result: PES position at the specified offset
+pkt_off: ~0: no PES found after the probe offset */
+static int _tsr_seek_probe(tsread *t, ffuint64 pkt_off, ffuint64 msec)
+{
+	if (pkt_off == ~0ULL) {
+		if (t->seek.hi_msec == ~0ULL) {
+			t->seek.n = _TSR_SEEK_MAX_PROBES; // no PES at the end of file
+			t->seek.hi_msec = 0;
+		} else {
+			t->seek.hi_off = t->seek.off;
+		}
+		return _tsr_seek_next(t, 0);
+	}
+
+	_tsr_log(t, "seek: probe result: offset:%xU  pos:%U", pkt_off, msec);
+
+	if (t->seek.hi_msec == ~0ULL)
+		t->seek.end_msec = msec;
+
+	if (msec <= t->seek.target) {
+		if (t->seek.hi_msec == ~0ULL) {
+			// the target is near the end of file
+			t->seek.hi_msec = msec;
+			t->seek.n = _TSR_SEEK_MAX_PROBES;
+		}
+		int progress = (pkt_off != t->seek.lo_off);
+		t->seek.lo_off = pkt_off;
+		t->seek.lo_msec = msec;
+		if (!progress)
+			t->seek.n = _TSR_SEEK_MAX_PROBES;
+		return _tsr_seek_next(t, 1);
+	}
+
+	t->seek.hi_off = pkt_off;
+	t->seek.hi_msec = msec;
+	return _tsr_seek_next(t, 0);
+}
+
+/** Get the number of packets with valid sync bytes */
+static ffsize _tsr_sync_count(const char *d, ffsize len)
+{
+	ffsize i;
+	for (i = 0;  i + 188 <= len;  i += 188) {
+		if ((ffbyte)d[i] != 0x47)
+			break;
+	}
+	return i / 188;
+}
+
+/** Get next packet.
+Parse packets right inside the input buffer;
+ gather only the packet split between the input buffers.
+Return 0: t->pkt is ready;
+ 0xfeed: need more data;
+ enum TSREAD_R */
+static int _tsr_pkt_next(tsread *t, ffstr *input)
+{
+	ffstr chunk;
+	int r;
+
+	if (input->ptr != t->bulk_ptr)
+		t->bulk_n = 0;
+
+	if (t->sync
+		&& ffstream_used(&t->stream) == 0
+		&& (t->bulk_n != 0
+			|| 0 != (t->bulk_n = _tsr_sync_count(input->ptr, input->len)))) {
+		t->bulk_ptr = input->ptr;
+		if (ts_pkt_read(&t->pkt, input->ptr, t->gather) > 0) {
+			t->pkt.off = t->off;
+			t->in_place = 1;
+			return 0;
+		}
+		t->bulk_n = 0; // bad packet: handle it below
+	}
 
 	for (;;) {
-		r = ffstream_gather(&t->stream, *input, t->gather, &chunk);
+		ffstr in = *input;
+		if (t->sync) // don't copy more than needed
+			in.len = ffmin(in.len, t->gather - ffmin(ffstream_used(&t->stream), t->gather));
+		r = ffstream_gather(&t->stream, in, t->gather, &chunk);
 		ffstr_shift(input, r);
 		t->off += r;
 		if (chunk.len < t->gather)
-			return TSREAD_MORE;
+			return 0xfeed;
 
 		if (!t->sync) {
 			r = ffstr_findchar(&chunk, 0x47);
@@ -137,6 +550,19 @@ static inline int tsread_process(tsread *t, ffstr *input, ffstr *output)
 				ffstream_consume(&t->stream, r);
 				continue;
 			}
+
+			// the next packet must start with sync byte too
+			if (t->total_size == 0 || t->off < t->total_size) {
+				r = ffstream_gather(&t->stream, *input, t->gather * 2, &chunk);
+				ffstr_shift(input, r);
+				t->off += r;
+				if (chunk.len < t->gather * 2)
+					return 0xfeed;
+				if ((ffbyte)chunk.ptr[t->gather] != 0x47) {
+					ffstream_consume(&t->stream, 1);
+					continue;
+				}
+			}
 		}
 		chunk.len = t->gather;
 
@@ -152,36 +578,105 @@ static inline int tsread_process(tsread *t, ffstr *input, ffstr *output)
 		}
 		t->sync = 1;
 		t->pkt.off = t->off - ffstream_used(&t->stream);
-		ffstream_consume(&t->stream, t->gather);
+		t->in_place = 0;
+		t->bulk_ptr = input->ptr;
+		return 0;
+	}
+}
 
-		const struct ts_packet *p = &t->pkt;
-		_tsr_log(t, "packet #%u: pid:%xu  counter:%u  adaptation:%u(%xu)  start:%u  payload:%u  offset:%xU"
-			, t->n_pkt++, p->pid, p->counter
-			, p->adaptation_len, p->adaptation_flags
-			, p->start, (int)p->body.len, p->off);
+static void _tsr_pkt_consume(tsread *t, ffstr *input)
+{
+	if (t->in_place) {
+		ffstr_shift(input, t->gather);
+		t->off += t->gather;
+		t->bulk_n--;
+		t->bulk_ptr = input->ptr;
+		return;
+	}
+	ffstream_consume(&t->stream, t->gather);
+}
+
+/** Process .ts data chunk.
+Return enum TSREAD_R */
+/* Algorithm:
+. Gather TS packet, find PES data packets by PID
+. Copy packet payload to the PES buffer until the PES is complete:
+   either its length is reached or the next PES for this PID starts
+. Return PES payload (or the frames from it) */
+static inline int tsread_process(tsread *t, ffstr *input, ffstr *output)
+{
+	int r;
+
+	if (t->pids == NULL)
+		return _TSR_ERR(t, "not enough memory");
+
+	if (t->frames_pm != NULL) {
+		if (0 != (r = _tsr_frame_next(t, output)))
+			return r;
+	}
 
-		struct _tsr_pm *pm = ffmap_find_hash(&t->pms, t->pkt.pid, (void*)(ffsize)t->pkt.pid, 4, NULL);
+	if (t->pes_done != NULL) {
+		t->pes_done->buf.len = 0;
+		t->pes_done = NULL;
+	}
+
+	if (t->seek.state == _TSR_SEEK_START) {
+		t->seek.lo_off = t->seek.off_first;
+		t->seek.lo_msec = 0;
+		t->seek.hi_off = t->total_size;
+		t->seek.hi_msec = t->seek.end_msec;
+		t->seek.n = 0;
+		return _tsr_seek_next(t, 0);
+	}
+
+	for (;;) {
+		r = _tsr_pkt_next(t, input);
+		if (r == 0xfeed) {
+			if (t->total_size != 0 && t->off >= t->total_size) {
+				if (t->seek.state == _TSR_SEEK_PROBE)
+					return _tsr_seek_probe(t, ~0ULL, 0);
+				return _tsr_flush(t, output);
+			}
+			return TSREAD_MORE;
+		} else if (r != 0) {
+			return r;
+		}
+
+		const struct ts_packet *p = &t->pkt;
+		if (!t->keep)
+			_tsr_log(t, "packet #%u: pid:%xu  counter:%u  adaptation:%u(%xu)  start:%u  payload:%u  offset:%xU"
+				, t->n_pkt++, p->pid, p->counter
+				, p->adaptation_len, p->adaptation_flags
+				, p->start, (int)p->body.len, p->off);
+		t->keep = 0;
+
+		struct _tsr_pm *pm = t->pids[t->pkt.pid];
 		if (!pm) {
+			_tsr_pkt_consume(t, input);
 			continue;
 		}
 
 		switch (pm->type) {
 		case _TSR_PMT_TOP:
+			_tsr_pkt_consume(t, input);
 			if ((r = ts_top_read(t->pkt.body)) <= 0)
 				return TSREAD_ERROR;
-			pm = _tsr_pm_add(t, r);
+			if (NULL == (pm = _tsr_pm_add(t, r)))
+				return _TSR_ERR(t, "not enough memory");
 			pm->type = _TSR_PMT_INFO;
 			_tsr_log(t, " pid_info:%xu"
 				, pm->pid);
 			break;
 
 		case _TSR_PMT_INFO: {
+			_tsr_pkt_consume(t, input);
 			ffuint stream_type;
 			if ((r = ts_info_read(t->pkt.body, &stream_type)) <= 0) {
 				t->error = "bad info block";
 				return TSREAD_ERROR;
 			}
-			pm = _tsr_pm_add(t, r);
+			if (NULL == (pm = _tsr_pm_add(t, r)))
+				return _TSR_ERR(t, "not enough memory");
 			pm->type = _TSR_PMT_DATA;
 			pm->stream_type = stream_type;
 			_tsr_log(t, " pid_data:%xu  stream_type:%xu"
@@ -190,17 +685,37 @@ static inline int tsread_process(tsread *t, ffstr *input, ffstr *output)
 		}
 
 		case _TSR_PMT_DATA:
-			if (t->pkt.start) {
-				if (0 == (r = ts_data_hdr_read(pm, t->pkt.body)))
-					return TSREAD_ERROR;
-				_tsr_log(t, " stream_id:%xu  packet:%u  pos:%U"
-					, pm->stream_id, pm->pkt_len, pm->pos_msec);
-				ffstr_shift(&t->pkt.body, r);
+			if (t->seek.state == _TSR_SEEK_PROBE) {
+				if (t->pkt.pid == t->seek.pid && t->pkt.start
+					&& 0 != ts_data_hdr_read(pm, t->pkt.body)) {
+					t->keep = 1;
+					r = _tsr_seek_probe(t, t->pkt.off, _tsr_pos_msec(t, pm->pts));
+					if (r != 0)
+						return r;
+					break; // process this packet normally
+				}
+
+				_tsr_pkt_consume(t, input);
+				if (t->pkt.off >= t->seek.hi_off)
+					return _tsr_seek_probe(t, ~0ULL, 0);
+				break;
+			}
+
+			if (!t->seek.ready && t->pkt.start) {
+				t->seek.ready = 1;
+				t->seek.pid = t->pkt.pid;
+				t->seek.off_first = t->pkt.off;
+				t->seek.end_msec = ~0ULL;
+				ts_data_hdr_read(pm, t->pkt.body);
+				t->seek.pts_first = pm->pts;
 			}
 
-			*output = t->pkt.body;
-			t->cur = pm;
-			return TSREAD_DATA;
+			r = _tsr_pes_add(t, pm, output);
+			if (!t->keep)
+				_tsr_pkt_consume(t, input);
+			if (r != 0)
+				return r;
+			break;
 		}
 	}
 }
@@ -210,13 +725,13 @@ static inline int tsread_process2(tsread *t, ffstr *input, union avpk_read_resul
 	int r = tsread_process(t, input, (ffstr*)&res->frame);
 	switch (r) {
 	case AVPK_DATA:
-		res->frame.pos = t->cur->pos_msec;
+		res->frame.pos = t->pos_msec;
 		res->frame.end_pos = ~0ULL;
 		res->frame.duration = ~0U;
 		break;
 
 	case AVPK_SEEK:
-		res->seek_offset = t->pkt.off;
+		res->seek_offset = t->off;
 		break;
 
 	case AVPK_ERROR:
@@ -228,13 +743,27 @@ static inline int tsread_process2(tsread *t, ffstr *input, union avpk_read_resul
 	return r;
 }
 
+/** Seek to the PES which contains the specified position.
+Positions are relative to the first PES in file, the same as tsread_pos_msec().
+msec: target position
+Return TSREAD_SEEK from tsread_process() until the PES is found (PTS-guided bisection). */
+static inline void tsread_seek(tsread *t, ffuint64 msec)
+{
+	if (!t->seek.ready || t->total_size == 0)
+		return;
+	t->seek.target = msec;
+	t->seek.state = _TSR_SEEK_START;
+}
+
+#define tsread_seek_offset(t)  ((t)->off)
+
 static inline const struct _tsr_pm* tsread_info(tsread *t)
 {
 	return t->cur;
 }
 
-#define tsread_pos_msec(t)  ((t)->cur->pos_msec)
+#define tsread_pos_msec(t)  ((t)->pos_msec)
 
 #define tsread_offset(t)  ((t)->pkt.off)
 
-AVPKR_IF_INIT(avpk_ts, "ts", AVPKF_TS, tsread, tsread_open2, tsread_process2, NULL, tsread_close);
+AVPKR_IF_INIT(avpk_ts, "ts", AVPKF_TS, tsread, tsread_open2, tsread_process2, tsread_seek, tsread_close);
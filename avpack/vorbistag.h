@@ -3,6 +3,9 @@
 */
 
 /*
+vorbistag_find
+vorbistagread_close
+vorbistagread_reset
 vorbistagread_process
 vorbistagwrite_destroy
 vorbistagwrite_add_name vorbistagwrite_add
@@ -23,13 +26,39 @@ typedef struct vorbistagread {
 	ffuint state;
 	ffuint cnt;
 	int tag; // enum FFMMTAG
+	ffuint field_len;
+	ffuint skip; // N of bytes left to skip
+	ffvec buf; // partial field data
+
+	ffuint partial; // User: input may be split at any point
+	ffuint field_max; // User: skip the fields larger than this (partial mode);  0: VORBISTAGREAD_FIELD_MAX
 } vorbistagread;
 
 enum VORBISTAGREAD_R {
 	VORBISTAGREAD_DONE = -1,
 	VORBISTAGREAD_ERROR = -2,
+	VORBISTAGREAD_MORE = -3, // need more input data (partial mode)
+};
+
+enum {
+	VORBISTAGREAD_FIELD_MAX = 1*1024*1024,
 };
 
+static inline void vorbistagread_close(vorbistagread *v)
+{
+	ffvec_free(&v->buf);
+}
+
+/** Prepare for reading a new tag block.
+User settings are preserved. */
+static inline void vorbistagread_reset(vorbistagread *v)
+{
+	v->state = 0;
+	v->cnt = 0;
+	v->skip = 0;
+	v->buf.len = 0;
+}
+
 static const ffbyte _vorbistag_mmtag[] = {
 	MMTAG_ALBUM,
 	MMTAG_ALBUMARTIST,
@@ -68,68 +97,120 @@ static const char *const _vorbistag_str[] = {
 	"TRACKTOTAL",
 };
 
-static int _vorbistagr_field_read(vorbistagread *v, ffstr *in, ffstr *name, ffstr *val)
+/** Get MMTAG by field name (case-insensitive).
+Return enum MMTAG */
+static inline int vorbistag_find(const char *name, ffsize len)
 {
-	if (4 > in->len)
-		return VORBISTAGREAD_ERROR;
-	unsigned n = ffint_le_cpu32_ptr(in->ptr);
-	ffstr_shift(in, 4);
+	ffuint i = _vorbistag_hash[_mmtag_hash_str(name, len, VORBISTAG_HASH_SEED, VORBISTAG_HASH_BITS)];
+	if (i == 0 || !_mmtag_ieq(name, len, _vorbistag_str[i - 1]))
+		return MMTAG_UNKNOWN;
+	return _vorbistag_mmtag[i - 1];
+}
 
-	if (n > in->len)
+/** Get 'n' bytes of data: from input directly or from the internal buffer.
+Return 0: 'out' is ready (valid until the next call)
+ <0: enum VORBISTAGREAD_R */
+static int _vorbistagr_gather(vorbistagread *v, ffstr *in, ffsize n, ffstr *out)
+{
+	if (v->buf.len == 0 && in->len >= n) {
+		ffstr_set(out, in->ptr, n);
+		ffstr_shift(in, n);
+		return 0;
+	}
+	if (!v->partial)
 		return VORBISTAGREAD_ERROR;
-	int r = ffs_findchar(in->ptr, n, '=');
-	if (r < 0)
+
+	if (NULL == ffvec_realloc(&v->buf, n, 1))
 		return VORBISTAGREAD_ERROR;
-	ffstr_set(name, in->ptr, r);
-	ffstr_set(val, in->ptr + r+1, n - (r+1));
-	ffstr_shift(in, n);
-	v->cnt--;
+	ffsize k = ffmin(n - v->buf.len, in->len);
+	ffvec_add(&v->buf, in->ptr, k, 1);
+	ffstr_shift(in, k);
+	if (v->buf.len < n)
+		return VORBISTAGREAD_MORE;
 
-	r = ffszarr_ifindsorted(_vorbistag_str, FF_COUNT(_vorbistag_str), name->ptr, name->len);
-	return (r >= 0) ? _vorbistag_mmtag[r] : (int)MMTAG_UNKNOWN;
+	ffstr_set(out, v->buf.ptr, n);
+	v->buf.len = 0;
+	return 0;
 }
 
 /** Get the next tag.
-Note: partial input is not supported.
+Partial mode ('partial' is set): the input may end at any point;
+ the data of a field split between 2 chunks is buffered;
+ the fields larger than 'field_max' are skipped without buffering.
+Otherwise the input must contain the whole tag data.
+name, val: valid until the next call
 Return >0: enum MMTAG
  <=0: enum VORBISTAGREAD_R */
 static inline int vorbistagread_process(vorbistagread *v, ffstr *in, ffstr *name, ffstr *val)
 {
-	enum { I_VENDOR, I_CMT_CNT, I_CMT };
-	ffuint n;
-
-	switch (v->state) {
-	case I_VENDOR:
-		if (4 > in->len)
-			return VORBISTAGREAD_ERROR;
-		n = ffint_le_cpu32_ptr(in->ptr);
-		ffstr_shift(in, 4);
-
-		if (n > in->len)
-			return VORBISTAGREAD_ERROR;
-		ffstr_setz(name, "VENDOR");
-		ffstr_set(val, in->ptr, n);
-		ffstr_shift(in, n);
-		v->state = I_CMT_CNT;
-		return MMTAG_VENDOR;
-
-	case I_CMT_CNT:
-		if (4 > in->len)
-			return VORBISTAGREAD_ERROR;
-		n = ffint_le_cpu32_ptr(in->ptr);
-		ffstr_shift(in, 4);
-		v->cnt = n;
-		v->state = I_CMT;
-		// fallthrough
-
-	case I_CMT:
-		if (v->cnt == 0)
-			return VORBISTAGREAD_DONE;
-
-		return _vorbistagr_field_read(v, in, name, val);
-	}
+	enum { I_VENDOR_LEN, I_VENDOR, I_CMT_CNT, I_CMT_LEN, I_CMT, I_VENDOR_SKIP, I_CMT_SKIP };
+	ffstr d;
+	int r, i;
+
+	for (;;) {
+		switch (v->state) {
+		case I_VENDOR_LEN:
+		case I_CMT_LEN:
+			if (v->state == I_CMT_LEN && v->cnt == 0)
+				return VORBISTAGREAD_DONE;
+
+			if ((r = _vorbistagr_gather(v, in, 4, &d)))
+				return r;
+			v->field_len = ffint_le_cpu32_ptr(d.ptr);
+			v->state++;
+
+			if (v->partial
+				&& v->field_len > ((v->field_max) ? v->field_max : VORBISTAGREAD_FIELD_MAX)) {
+				v->skip = v->field_len;
+				v->state = (v->state == I_VENDOR) ? I_VENDOR_SKIP : I_CMT_SKIP;
+			}
+			continue;
 
-	return VORBISTAGREAD_ERROR;
+		case I_VENDOR:
+			if ((r = _vorbistagr_gather(v, in, v->field_len, &d)))
+				return r;
+			ffstr_setz(name, "VENDOR");
+			*val = d;
+			v->state = I_CMT_CNT;
+			return MMTAG_VENDOR;
+
+		case I_CMT_CNT:
+			if ((r = _vorbistagr_gather(v, in, 4, &d)))
+				return r;
+			v->cnt = ffint_le_cpu32_ptr(d.ptr);
+			v->state = I_CMT_LEN;
+			continue;
+
+		case I_CMT:
+			if ((r = _vorbistagr_gather(v, in, v->field_len, &d)))
+				return r;
+			if ((i = ffs_findchar(d.ptr, d.len, '=')) < 0)
+				return VORBISTAGREAD_ERROR;
+			ffstr_set(name, d.ptr, i);
+			ffstr_set(val, d.ptr + i+1, d.len - (i+1));
+			v->cnt--;
+			v->state = I_CMT_LEN;
+			return vorbistag_find(name->ptr, name->len);
+
+		case I_VENDOR_SKIP:
+		case I_CMT_SKIP: {
+			ffsize n = ffmin(v->skip, in->len);
+			ffstr_shift(in, n);
+			v->skip -= n;
+			if (v->skip != 0)
+				return VORBISTAGREAD_MORE;
+			if (v->state == I_VENDOR_SKIP) {
+				v->state = I_CMT_CNT;
+			} else {
+				v->cnt--;
+				v->state = I_CMT_LEN;
+			}
+			continue;
+		}
+		}
+
+		return VORBISTAGREAD_ERROR;
+	}
 }
 
 
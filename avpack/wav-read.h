@@ -21,7 +21,7 @@ wavread_tag
 
 struct wav_chunk {
 	ffuint id;
-	ffuint size;
+	ffuint64 size;
 	ffuint flags;
 	const struct wav_bchunk *ctx;
 };
@@ -49,6 +49,7 @@ typedef struct wavread {
 		, off;
 	ffuint64 cursample;
 	ffuint64 seek_sample;
+	ffuint64 ds64_data_size; // RF64: the real size of data chunk
 	ffuint has_fmt :1
 		, fin :1
 		, inf_data :1
@@ -84,9 +85,11 @@ static int _wavread_findchunk(wavread *w, const void *data, const struct wav_bch
 	}
 
 	chunk->size = ffint_le_cpu32_ptr(ch->size);
+	if (chunk->id == WAV_T_DATA && chunk->size == (ffuint)-1 && w->ds64_data_size != 0)
+		chunk->size = w->ds64_data_size;
 	chunk->flags |= (chunk->size % 2) ? WAV_F_PADD : 0;
 
-	_wavread_log(w, "chunk \"%4s\"  size:%u  off:%xU"
+	_wavread_log(w, "chunk \"%4s\"  size:%U  off:%xU"
 		, ch->id, chunk->size, off);
 	return 0;
 }
@@ -103,7 +106,7 @@ static inline void wavread_open(wavread *w)
 {
 	w->seek_sample = (ffuint64)-1;
 	w->chunks[0].ctx = wav_ctx_global;
-	w->chunks[0].size = (ffuint)-1;
+	w->chunks[0].size = (ffuint64)-1;
 }
 
 static inline void wavread_open2(wavread *w, struct avpk_reader_conf *conf)
@@ -160,6 +163,18 @@ static int _wavread_chunk(wavread *w)
 			return _WAVR_ERR(w, "not enough memory");
 		break;
 
+	case WAV_T_DS64: {
+		ffuint64 riff_size;
+		if (0 != wav_ds64_read(w->gbuf.ptr, w->gbuf.len, &riff_size, &w->ds64_data_size))
+			return _WAVR_ERR(w, "bad ds64 chunk");
+
+		// replace the 32-bit size of RIFF chunk
+		struct wav_chunk *riff = &w->chunks[w->ictx - 1];
+		if (riff_size + sizeof(struct wav_chunkhdr) > w->off)
+			riff->size = riff_size + sizeof(struct wav_chunkhdr) - w->off;
+		break;
+	}
+
 	case WAV_T_LIST:
 		if (!!ffmem_cmp(w->gbuf.ptr, "INFO", 4)) {
 			return 0xbad;
@@ -345,7 +360,7 @@ static inline int wavread_process(wavread *w, ffstr *input, ffstr *output)
 				return WAVREAD_SEEK;
 			}
 
-			ffuint chunk_size = w->dataoff + w->datasize - w->off;
+			ffuint64 chunk_size = w->dataoff + w->datasize - w->off;
 			if (chunk_size == 0) {
 				chunk = &w->chunks[w->ictx];
 				chunk->size -= w->datasize;
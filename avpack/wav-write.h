@@ -22,13 +22,24 @@ typedef struct wavwrite {
 	const char *errmsg;
 	ffvec buf;
 	ffuint doff;
-	ffuint dsize;
 	ffuint sampsize;
+	ffuint64 dsize;
 	ffuint64 off;
 	struct wav_info info;
 	ffuint fin :1;
+	ffuint bw64 :1; // User: write "BW64" rather than "RF64" header for large files
+
+	/** User: output alignment for direct I/O (power of 2); 0: disabled.
+	Every output block is aligned in memory, in size and in file offset. */
+	ffuint align;
+	char *block;
+	ffuint block_len, block_size;
 } wavwrite;
 
+enum {
+	WAVWRITE_BLOCK = 64*1024, // default output block size in aligned mode
+};
+
 /**
 info.format, sample_rate, channels are required
 info.total_samples is optional
@@ -57,6 +68,8 @@ static inline int wavwrite_create2(wavwrite *w, struct avpk_info *info)
 static inline void wavwrite_close(wavwrite *w)
 {
 	ffvec_free(&w->buf);
+	if (w->block != NULL)
+		ffmem_alignfree(w->block);
 }
 
 static inline const char* wavwrite_error(wavwrite *w)
@@ -75,46 +88,132 @@ enum WAVWRITE_R {
 	WAVWRITE_ERROR = AVPK_ERROR,
 };
 
+/** Get the size of padding after data in aligned mode: [pad byte] JUNK */
+static ffuint _wavw_tail(wavwrite *w)
+{
+	ffuint64 end = w->doff + w->dsize;
+	if (w->align == 0 || (end & (w->align - 1)) == 0)
+		return 0;
+	return ffint_align_ceil2(end + (w->dsize & 1) + sizeof(struct wav_chunkhdr), w->align) - end;
+}
+
+/** Write header: RIFF or RF64/BW64, if data size doesn't fit into 32 bits */
+static int _wavw_hdr(wavwrite *w, char *p)
+{
+	char *start = p;
+	ffuint64 riff_size = w->doff + w->dsize + _wavw_tail(w) - sizeof(struct wav_chunkhdr);
+	ffuint dsize = w->dsize;
+	if (w->dsize == (ffuint64)-1) {
+		riff_size = (ffuint)-1;
+		dsize = (ffuint)-1;
+	}
+
+	if (riff_size > (ffuint)-1) {
+		p += wav_chunk_write(p, (w->bw64) ? "BW64" : "RF64", (ffuint)-1);
+		p = ffmem_copy(p, "WAVE", 4);
+		p += wav_ds64_write(p, riff_size, w->dsize, w->dsize / w->sampsize);
+		dsize = (ffuint)-1;
+	} else {
+		p += wav_chunk_write(p, "RIFF", riff_size);
+		p = ffmem_copy(p, "WAVE", 4);
+		// reserve space for ds64
+		p += wav_chunk_write(p, "JUNK", sizeof(struct wav_ds64));
+		ffmem_zero(p, sizeof(struct wav_ds64));
+		p += sizeof(struct wav_ds64);
+	}
+
+	p += wav_chunk_write(p, "fmt ", sizeof(struct wav_fmt));
+	p += wav_fmt_write(p, &w->info);
+
+	if (w->align != 0) {
+		// data starts at aligned offset
+		ffuint n = w->doff - (p - start) - 2 * sizeof(struct wav_chunkhdr);
+		p += wav_chunk_write(p, "JUNK", n);
+		ffmem_zero(p, n);
+		p += n;
+	}
+
+	p += wav_chunk_write(p, "data", dsize);
+	return p - start;
+}
+
+/** Coalesce data into aligned blocks; add padding after the last block.
+Return 0 if all data is written */
+static int _wavw_block(wavwrite *w, ffstr *input, ffstr *output)
+{
+	if (input->len != 0) {
+		ffsize n = ffmin(input->len, w->block_size - w->block_len);
+		ffmem_copy(w->block + w->block_len, input->ptr, n);
+		ffstr_shift(input, n);
+		w->block_len += n;
+		w->dsize += n;
+		if (w->block_len != w->block_size)
+			return WAVWRITE_MORE;
+
+	} else if (w->fin && w->block_len != 0) {
+		ffuint pad = w->dsize & 1;
+		ffuint n = _wavw_tail(w);
+		char *p = w->block + w->block_len;
+		ffmem_zero(p, n);
+		wav_chunk_write(p + pad, "JUNK", n - pad - sizeof(struct wav_chunkhdr));
+		w->block_len += n;
+
+	} else {
+		return 0;
+	}
+
+	ffstr_set(output, w->block, w->block_len);
+	w->block_len = 0;
+	return WAVWRITE_DATA;
+}
+
 /**
 Return enum WAVWRITE_R */
 /*
-. Write header
+. Write header with JUNK chunk
 . Write data
-. Seek to 0 and finalize header, if necessary
+. Seek to 0 and finalize header, if necessary;
+   replace JUNK with ds64 if data is larger than 4GB
+
+Aligned mode:
+. Pad header with JUNK chunk so that data starts at aligned offset
+. Write data by aligned blocks; pad the last block with JUNK chunk
+. Rewrite the header: its size ('doff') is aligned
 */
 static inline int wavwrite_process(wavwrite *w, ffstr *input, ffstr *output)
 {
 	enum {
 		W_HDR, W_DATA, W_HDRFIN, W_DONE,
 	};
+	int r;
 
 	switch (w->state) {
 	case W_HDR:
 		w->sampsize = (w->info.format&0xff)/8 * w->info.channels;
 		w->dsize = (w->info.total_samples != 0)
 			? w->info.total_samples * w->sampsize
-			: (ffuint)-1;
+			: (ffuint64)-1;
 		w->doff = sizeof(struct wav_chunkhdr) + FFS_LEN("WAVE")
+			+ sizeof(struct wav_chunkhdr) + sizeof(struct wav_ds64)
 			+ sizeof(struct wav_chunkhdr) + sizeof(struct wav_fmt)
 			+ sizeof(struct wav_chunkhdr);
-		if (NULL == ffvec_alloc(&w->buf, w->doff, 1))
+
+		if (w->align != 0) {
+			if (!ffint_ispower2(w->align))
+				return _WAVW_ERR(w, "alignment must be a power of 2");
+			w->doff = ffint_align_ceil2(w->doff + sizeof(struct wav_chunkhdr), w->align);
+			w->block_size = ffmax(ffint_align_ceil2(WAVWRITE_BLOCK, w->align), w->doff);
+			// +align: room for padding after the last block
+			if (NULL == (w->block = (char*)ffmem_align(w->block_size + w->align, w->align)))
+				return _WAVW_ERR(w, "not enough memory");
+		} else if (NULL == ffvec_alloc(&w->buf, w->doff, 1)) {
 			return _WAVW_ERR(w, "not enough memory");
+		}
 		// fallthrough
 
 	case W_HDRFIN: {
-		ffuint riff_size = w->doff + w->dsize - sizeof(struct wav_chunkhdr);
-		if (w->dsize == (ffuint)-1)
-			riff_size = (ffuint)-1;
-		char *p = w->buf.ptr;
-		p += wav_chunk_write(w->buf.ptr, "RIFF", riff_size);
-		p = ffmem_copy(p, "WAVE", 4);
-
-		p += wav_chunk_write(p, "fmt ", sizeof(struct wav_fmt));
-		p += wav_fmt_write(p, &w->info);
-
-		p += wav_chunk_write(p, "data", w->dsize);
-
-		ffstr_set(output, w->buf.ptr, p - (char*)w->buf.ptr);
+		char *hdr = (w->align != 0) ? w->block : (char*)w->buf.ptr;
+		ffstr_set(output, hdr, _wavw_hdr(w, hdr));
 
 		if (w->state == W_HDRFIN) {
 			w->state = W_DONE;
@@ -130,25 +229,25 @@ static inline int wavwrite_process(wavwrite *w, ffstr *input, ffstr *output)
 		return WAVWRITE_DONE;
 
 	case W_DATA:
-		if (input->len == 0) {
-			if (!w->fin)
-				return WAVWRITE_MORE;
-
-			if (w->dsize == w->info.total_samples * w->sampsize)
-				return WAVWRITE_DONE; // header already has the correct data size
-
-			w->state = W_HDRFIN;
-			w->off = 0;
-			return WAVWRITE_SEEK;
+		if (w->align != 0) {
+			if (0 != (r = _wavw_block(w, input, output)))
+				return r;
+		} else if (input->len != 0) {
+			w->dsize += input->len;
+			*output = *input;
+			input->len = 0;
+			return WAVWRITE_DATA;
 		}
 
-		if ((ffuint64)w->dsize + input->len > (ffuint)-1)
-			return _WAVW_ERR(w, "too large data");
+		if (!w->fin)
+			return WAVWRITE_MORE;
 
-		w->dsize += input->len;
-		*output = *input;
-		input->len = 0;
-		return WAVWRITE_DATA;
+		if (w->dsize == w->info.total_samples * w->sampsize)
+			return WAVWRITE_DONE; // header already has the correct data size
+
+		w->state = W_HDRFIN;
+		w->off = 0;
+		return WAVWRITE_SEEK;
 	}
 
 	// unreachable
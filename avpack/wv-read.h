@@ -16,8 +16,7 @@ wvread_tag
 #pragma once
 #include <avpack/decl.h>
 #include <avpack/base/wv.h>
-#include <avpack/id3v1.h>
-#include <avpack/apetag.h>
+#include <avpack/tailtag.h>
 #include <avpack/shared.h>
 #include <ffbase/vector.h>
 
@@ -34,6 +33,11 @@ struct wv_seekpoint {
 	ffuint64 off;
 };
 
+struct _wvr_blk {
+	ffuint64 off;
+	ffuint index, samples;
+};
+
 typedef void (*wv_log_t)(void *udata, const char *fmt, va_list va);
 
 typedef struct wvread {
@@ -55,8 +59,13 @@ typedef struct wvread {
 	ffuint64 seek_sample;
 	ffuint eof :1;
 
-	struct id3v1read id3v1;
-	struct apetagread apetag;
+	/** Offsets of all blocks seen during reading and seeking.
+	Seeking to a sample inside a known block requires just 1 seek request. */
+	ffvec index; // struct _wvr_blk[], sorted by block index
+	ffuint64 index_off;
+	ffuint index_build :1; // User: build the full index before reading audio, by hopping over block headers
+
+	struct tailtagread tail;
 	ffstr tagname, tagval;
 	int tag;
 
@@ -101,13 +110,17 @@ static inline void wvread_open(wvread *w, ffuint64 total_size)
 static inline void wvread_open2(wvread *w, struct avpk_reader_conf *conf)
 {
 	wvread_open(w, !(conf->flags & AVPKR_F_NO_SEEK) ? conf->total_size : 0);
-	w->id3v1.codepage = conf->code_page;
+	w->tail.id3v1.codepage = conf->code_page;
+	w->tail.codepage = conf->code_page;
+	w->tail.window = conf->tail_size;
+	w->index_build = !!(conf->flags & AVPKR_F_INDEX);
 }
 
 static inline void wvread_close(wvread *w)
 {
 	ffvec_free(&w->buf);
-	apetagread_close(&w->apetag);
+	ffvec_free(&w->index);
+	tailtagread_close(&w->tail);
 }
 
 static inline void _wvr_log(wvread *w, const char *fmt, ...)
@@ -182,6 +195,74 @@ static int _wvr_hdr_find(wvread *w, struct wv_hdr *h, ffstr *input, ffstr *outpu
 	return 0;
 }
 
+/** Get file offset of the block header that has just been found */
+static ffuint64 _wvr_blk_off(wvread *w)
+{
+	if (w->buf.len != 0)
+		return w->off - w->buf.len;
+	return w->off - sizeof(struct wv_hdr_fmt);
+}
+
+/** Find the last block with index <= 'sample'
+Return -1 if none */
+static ffssize _wvr_index_find(wvread *w, ffuint64 sample)
+{
+	const struct _wvr_blk *b = (struct _wvr_blk*)w->index.ptr;
+	ffsize i = 0, n = w->index.len;
+	while (i != n) {
+		ffsize m = i + (n - i) / 2;
+		if (b[m].index <= sample)
+			i = m + 1;
+		else
+			n = m;
+	}
+	return (ffssize)i - 1;
+}
+
+/** Add block to the index */
+static void _wvr_index_add(wvread *w, const struct wv_hdr *h, ffuint64 off)
+{
+	if (h->samples == 0)
+		return;
+
+	struct _wvr_blk *b = (struct _wvr_blk*)w->index.ptr;
+	ffssize i = _wvr_index_find(w, h->index);
+	if (i >= 0 && b[i].index == h->index) {
+		// multi-channel stream: the first block of the group
+		if (b[i].off > off)
+			b[i].off = off;
+		return;
+	}
+
+	if (NULL == ffvec_growT(&w->index, 1, struct _wvr_blk))
+		return;
+	b = (struct _wvr_blk*)w->index.ptr;
+	i++;
+	ffmem_move(&b[i + 1], &b[i], (w->index.len - i) * sizeof(struct _wvr_blk));
+	b[i].off = off;
+	b[i].index = h->index;
+	b[i].samples = h->samples;
+	w->index.len++;
+}
+
+/** Find the block containing the seek target in the index
+Return 0 if found: w->off is set */
+static int _wvr_index_seek(wvread *w)
+{
+	ffssize i = _wvr_index_find(w, w->seek_sample);
+	if (i < 0)
+		return -1;
+
+	const struct _wvr_blk *b = (struct _wvr_blk*)w->index.ptr;
+	if (w->seek_sample >= (ffuint64)b[i].index + b[i].samples)
+		return -1;
+
+	_wvr_log(w, "seek: tgt:%xU  index:%xU  off:%xU"
+		, w->seek_sample, (ffuint64)b[i].index, b[i].off);
+	w->off = b[i].off;
+	return 0;
+}
+
 static int _wvr_seek_prepare(wvread *w)
 {
 	if (w->total_size == 0)
@@ -191,6 +272,18 @@ static int _wvr_seek_prepare(wvread *w)
 	w->seekpt[0].off = 0;
 	w->seekpt[1].pos = w->info.total_samples;
 	w->seekpt[1].off = w->total_size;
+
+	// narrow the search window with the known blocks around the target
+	ffssize i = _wvr_index_find(w, w->seek_sample);
+	const struct _wvr_blk *b = (struct _wvr_blk*)w->index.ptr;
+	if (i >= 0) {
+		w->seekpt[0].pos = b[i].index;
+		w->seekpt[0].off = b[i].off;
+	}
+	if ((ffsize)(i + 1) < w->index.len) {
+		w->seekpt[1].pos = b[i + 1].index;
+		w->seekpt[1].off = b[i + 1].off;
+	}
 	return 0;
 }
 
@@ -249,10 +342,11 @@ Return enum WVREAD_R */
 static inline int wvread_process(wvread *w, ffstr *input, ffstr *output)
 {
 	enum {
-		R_FTR_SEEK, R_ID3V1, R_APETAG_FTR, R_APETAG, R_HDR_SEEK,
+		R_FTR_SEEK, R_TAILTAG, R_HDR_SEEK,
 		R_HDR_FIND, R_BLOCK,
 		R_SEEK_OFF, R_SEEK_HDR,
 		R_GATHER, R_GATHER_MORE,
+		R_INDEX_NEXT, R_INDEX_HDR,
 	};
 	int r;
 
@@ -264,6 +358,11 @@ static inline int wvread_process(wvread *w, ffstr *input, ffstr *output)
 		switch (w->state) {
 		case R_HDR_FIND: {
 			if (w->seek_sample != (ffuint64)-1 && w->hdr_ok) {
+				if (0 == _wvr_index_seek(w)) {
+					w->seek_sample = (ffuint64)-1;
+					w->buf.len = 0;
+					return WVREAD_SEEK;
+				}
 				if (0 != _wvr_seek_prepare(w))
 					return WVREAD_ERROR;
 				w->state = R_SEEK_OFF;
@@ -276,6 +375,7 @@ static inline int wvread_process(wvread *w, ffstr *input, ffstr *output)
 
 			_wvr_log(w, "index:%u  samples:%u  size:%u"
 				, h.index, h.samples, h.size);
+			_wvr_index_add(w, &h, _wvr_blk_off(w));
 
 			if (!w->hdr_ok) {
 				w->hdr_ok = 1;
@@ -316,9 +416,8 @@ static inline int wvread_process(wvread *w, ffstr *input, ffstr *output)
 				return WVREAD_MORE;
 			}
 
-			blk_off = w->off - sizeof(struct wv_hdr_fmt);
-			if (w->buf.len != 0)
-				blk_off = w->off - w->buf.len;
+			blk_off = _wvr_blk_off(w);
+			_wvr_index_add(w, &h, blk_off);
 
 			if (blk_off >= w->seekpt[1].off) {
 				ffint64 o;
@@ -371,88 +470,92 @@ seek_edge:
 				continue;
 			}
 
-			w->state = R_GATHER,  w->nextstate = R_ID3V1;
-			w->gather_size = sizeof(struct apetaghdr) + sizeof(struct id3v1);
-			w->gather_size = ffmin(w->gather_size, w->total_size);
-			w->off = w->total_size - w->gather_size;
-			return WVREAD_SEEK;
-
-		case R_ID3V1: {
-			if (sizeof(struct id3v1) > w->chunk.len) {
-				w->state = R_APETAG_FTR;
-				continue;
-			}
+			tailtagread_open(&w->tail, w->total_size);
+			w->state = R_TAILTAG;
+			// fallthrough
 
-			ffstr id3;
-			ffstr_set(&id3, &w->chunk.ptr[w->chunk.len - sizeof(struct id3v1)], sizeof(struct id3v1));
-			r = id3v1read_process(&w->id3v1, id3, &w->tagval);
+		case R_TAILTAG:
+			r = tailtagread_process(&w->tail, input, &w->tagname, &w->tagval);
 
 			switch (r) {
-			case ID3V1READ_DONE:
-				w->total_size -= sizeof(struct id3v1);
-				w->chunk.len -= sizeof(struct id3v1);
-				w->off -= sizeof(struct id3v1);
-				break;
+			case TAILTAGREAD_SEEK:
+				w->off = tailtagread_offset(&w->tail);
+				return WVREAD_SEEK;
 
-			case ID3V1READ_NO:
+			case TAILTAGREAD_MORE:
+				return WVREAD_MORE;
+
+			case TAILTAGREAD_WARN:
+				w->error = tailtagread_error(&w->tail);
+				return WVREAD_WARN;
+
+			case TAILTAGREAD_DONE:
+				w->total_size = w->tail.total_size;
+				tailtagread_close(&w->tail);
+				w->state = R_HDR_SEEK;
 				break;
 
 			default:
 				w->tag = -r;
-				return WVREAD_ID31;
+				return WVREAD_APETAG;
 			}
-		}
 			// fallthrough
 
-		case R_APETAG_FTR: {
-			apetagread_open(&w->apetag);
-			ffint64 seek;
-			r = apetagread_footer(&w->apetag, w->chunk, &seek);
-
-			switch (r) {
-			case APETAGREAD_SEEK:
-				w->off += seek;
-				w->total_size = w->off;
-				w->state = R_APETAG;
-				return WVREAD_SEEK;
-
-			default:
-				w->state = R_HDR_SEEK;
+		case R_HDR_SEEK:
+			if (w->index_build && w->index.len == 0) {
+				w->index_build = 0;
+				w->index_off = 0;
+				w->state = R_INDEX_NEXT;
 				continue;
 			}
-			break;
-		}
 
-		case R_APETAG: {
-			ffsize len = input->len;
-			r = apetagread_process(&w->apetag, input, &w->tagname, &w->tagval);
-			w->off += len - input->len;
+			w->state = R_HDR_FIND;
+			w->off = 0;
+			w->buf.len = 0;
+			return WVREAD_SEEK;
 
-			switch (r) {
-			case APETAGREAD_MORE:
-				return WVREAD_MORE;
 
-			case APETAGREAD_DONE:
-				apetagread_close(&w->apetag);
+		case R_INDEX_NEXT:
+			if (w->index_off >= w->total_size) {
 				w->state = R_HDR_SEEK;
-				break;
+				continue;
+			}
+
+			w->state = R_GATHER,  w->nextstate = R_INDEX_HDR;
+			w->gather_size = sizeof(struct wv_hdr_fmt);
+			if (w->index_off >= w->off && w->index_off - w->off <= input->len) {
+				// the next header is inside the current input buffer
+				ffstr_shift(input, w->index_off - w->off);
+				w->off = w->index_off;
+				continue;
+			}
+			w->off = w->index_off;
+			w->buf.len = 0;
+			return WVREAD_SEEK;
 
-			case APETAGREAD_ERROR:
+		case R_INDEX_HDR: {
+			struct wv_hdr h;
+			if (sizeof(struct wv_hdr_fmt) != wv_hdr_read(&h, w->chunk.ptr, w->chunk.len)) {
+				// not a block header: the rest of the file will be indexed on demand
+				_wvr_log(w, "index: no block header at offset %xU", w->index_off);
 				w->state = R_HDR_SEEK;
-				w->error = apetagread_error(&w->apetag);
-				return WVREAD_WARN;
+				continue;
+			}
 
-			default:
-				w->tag = -r;
-				return WVREAD_APETAG;
+			if (!w->hdr_ok) {
+				w->hdr_ok = 1;
+				w->info.total_samples = h.total_samples;
+				w->info.bits = h.bits;
+				w->info.flt = h.flt;
+				w->info.channels = h.channels;
+				w->info.sample_rate = h.sample_rate;
 			}
-		}
-			// fallthrough
 
-		case R_HDR_SEEK:
-			w->state = R_HDR_FIND;
-			w->off = 0;
-			return WVREAD_SEEK;
+			_wvr_index_add(w, &h, w->index_off);
+			w->index_off += h.size;
+			w->state = R_INDEX_NEXT;
+			continue;
+		}
 		}
 	}
 }
@@ -0,0 +1,125 @@
+/** avpack: HLS media playlist tester
+2026, Simon Zolin
+*/
+
+#include <avpack/hls.h>
+#include <test/test.h>
+
+static const char hls_pl1[] = "\
+#EXTM3U\n\
+#EXT-X-VERSION:4\n\
+#EXT-X-TARGETDURATION:6\n\
+#EXT-X-MEDIA-SEQUENCE:10\n\
+#EXT-X-PROGRAM-DATE-TIME:2026-01-02T03:04:05.500Z\n\
+#EXTINF:5.005,\n\
+seg10.ts\n\
+#EXT-X-BYTERANGE:1000@200\n\
+#EXTINF:6,\n\
+seg11.ts\n\
+#EXT-X-BYTERANGE:500\n\
+#EXTINF:4.5,\n\
+seg11.ts\n\
+";
+
+// the first segment is removed, 2 new segments are appended
+static const char hls_pl2[] = "\
+#EXTM3U\n\
+#EXT-X-VERSION:4\n\
+#EXT-X-TARGETDURATION:6\n\
+#EXT-X-MEDIA-SEQUENCE:11\n\
+#EXT-X-BYTERANGE:1000@200\n\
+#EXTINF:6,\n\
+seg11.ts\n\
+#EXT-X-BYTERANGE:500\n\
+#EXTINF:4.5,\n\
+seg11.ts\n\
+#EXTINF:6.000,\n\
+seg13.ts\r\n\
+#EXT-X-PROGRAM-DATE-TIME:2026-01-02T05:04:05+02:00\n\
+#EXTINF:6.1,title\n\
+seg14.ts";
+
+// the previous last segment is different
+static const char hls_pl3[] = "\
+#EXTM3U\n\
+#EXT-X-TARGETDURATION:6\n\
+#EXT-X-MEDIA-SEQUENCE:13\n\
+#EXTINF:6.000,\n\
+seg13.ts\n\
+#EXTINF:6.1,title\n\
+seg14-changed.ts\n\
+#EXTINF:6,\n\
+seg15.ts\n\
+#EXT-X-ENDLIST\n\
+";
+
+static const struct hls_segment* hls_update(hlsread *h, const char *data, ffsize len, ffsize n_new)
+{
+	ffstr d = FFSTR_INITN(data, len);
+	xieq(0, hlsread_update(h, d));
+	xieq(n_new, h->segments.len);
+	return (struct hls_segment*)h->segments.ptr;
+}
+
+void test_hls()
+{
+	const ffint64 date = 1767323045500LL; // 2026-01-02T03:04:05.500Z
+	hlsread h = {};
+	hlsread_open(&h);
+
+	const struct hls_segment *s = hls_update(&h, hls_pl1, sizeof(hls_pl1)-1, 3);
+	xieq(h.target_duration, 6);
+	xieq(h.media_seq, 10);
+	xieq(s[0].seq, 10);
+	xseq(&s[0].url, "seg10.ts");
+	xieq(s[0].duration_msec, 5005);
+	xieq(s[0].date_msec, date);
+	xieq(s[0].range_len, 0);
+	xieq(s[1].seq, 11);
+	xieq(s[1].duration_msec, 6000);
+	xieq(s[1].range_off, 200);
+	xieq(s[1].range_len, 1000);
+	xieq(s[1].date_msec, date + 5005);
+	xieq(s[2].seq, 12);
+	xseq(&s[2].url, "seg11.ts");
+	xieq(s[2].duration_msec, 4500);
+	xieq(s[2].range_off, 1200);
+	xieq(s[2].range_len, 500);
+	xieq(h.full_parse, 1);
+
+	// only the new segments are parsed
+	s = hls_update(&h, hls_pl2, sizeof(hls_pl2)-1, 2);
+	xieq(h.full_parse, 1);
+	xieq(s[0].seq, 13);
+	xseq(&s[0].url, "seg13.ts");
+	xieq(s[0].duration_msec, 6000);
+	xieq(s[0].range_len, 0);
+	xieq(s[0].date_msec, date + 5005 + 6000 + 4500);
+	xieq(s[1].seq, 14);
+	xseq(&s[1].url, "seg14.ts");
+	xieq(s[1].duration_msec, 6100);
+	xieq(s[1].date_msec, date - 500); // 03:04:05Z
+	x(!h.end);
+
+	// no changes
+	hls_update(&h, hls_pl2, sizeof(hls_pl2)-1, 0);
+	xieq(h.full_parse, 1);
+
+	// mismatch: the whole playlist is parsed, but only the new segments are returned
+	s = hls_update(&h, hls_pl3, sizeof(hls_pl3)-1, 1);
+	xieq(h.full_parse, 2);
+	xieq(s[0].seq, 15);
+	xseq(&s[0].url, "seg15.ts");
+	x(h.end);
+
+	hlsread_close(&h);
+
+	// time zone is truncated: must not read past the end
+	char *date_s = ffmem_alloc(25);
+	ffmem_copy(date_s, "2026-01-02T03:04:05+02:0", 24);
+	ffstr ds = FFSTR_INITN(date_s, 24);
+	xieq(0, _hlsr_date_msec(ds));
+	ffmem_copy(date_s, "2026-01-02T03:04:05+0200", 24);
+	xieq(date - 500 - 2*60*60*1000, _hlsr_date_msec(ds));
+	ffmem_free(date_s);
+}
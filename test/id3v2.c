@@ -0,0 +1,203 @@
+/** avpack: ID3v2 data decoding tester and microbenchmark
+2026, Simon Zolin
+*/
+
+#include <avpack/base/id3v2.h>
+#include <test/test.h>
+#include <time.h>
+
+extern int Verbose;
+
+/** Reference implementations */
+
+static ffsize unsync_ref(char *dst, const char *src, ffsize len)
+{
+	char *p = dst;
+	ffuint skip0 = 0;
+	for (ffsize i = 0;  i < len;  i++) {
+		if (skip0) {
+			skip0 = 0;
+			*p++ = 0xff;
+			if (src[i] == 0)
+				continue;
+		}
+		if ((ffbyte)src[i] == 0xff) {
+			skip0 = 1;
+			continue;
+		}
+		*p++ = src[i];
+	}
+	return p - dst;
+}
+
+static ffsize utf16_ref(char *dst, const char *src, ffsize len, ffuint be)
+{
+	char *p = dst;
+	const ffbyte *s = (ffbyte*)src;
+	for (ffsize i = 0;  i + 1 < len;  i += 2) {
+		ffuint c = (be) ? (s[i] << 8) | s[i+1] : (s[i+1] << 8) | s[i];
+		if (c >= 0xd800 && c < 0xdc00 && i + 3 < len) {
+			ffuint c2 = (be) ? (s[i+2] << 8) | s[i+3] : (s[i+3] << 8) | s[i+2];
+			if (c2 >= 0xdc00 && c2 < 0xe000) {
+				c = 0x10000 + ((c - 0xd800) << 10) + (c2 - 0xdc00);
+				i += 2;
+			}
+		}
+		if (c >= 0xd800 && c < 0xe000)
+			c = 0xfffd;
+
+		if (c < 0x80) {
+			*p++ = c;
+		} else if (c < 0x800) {
+			*p++ = 0xc0 | (c >> 6);
+			*p++ = 0x80 | (c & 0x3f);
+		} else if (c < 0x10000) {
+			*p++ = 0xe0 | (c >> 12);
+			*p++ = 0x80 | ((c >> 6) & 0x3f);
+			*p++ = 0x80 | (c & 0x3f);
+		} else {
+			*p++ = 0xf0 | (c >> 18);
+			*p++ = 0x80 | ((c >> 12) & 0x3f);
+			*p++ = 0x80 | ((c >> 6) & 0x3f);
+			*p++ = 0x80 | (c & 0x3f);
+		}
+	}
+	return p - dst;
+}
+
+static ffuint rnd_state = 1;
+static ffuint rnd()
+{
+	rnd_state = rnd_state * 1103515245 + 12345;
+	return rnd_state >> 16;
+}
+
+/** Fill with text; 'rare' out of 256 bytes are FF 00 or FF xx sequences */
+static void unsync_fill(char *d, ffsize n, ffuint rare)
+{
+	for (ffsize i = 0;  i < n;  i++) {
+		d[i] = 'a' + rnd() % 26;
+		if (rnd() % 256 < rare) {
+			d[i] = (char)0xff;
+			if (i + 1 < n)
+				d[++i] = (rnd() & 1) ? 0 : (char)0xe0;
+		}
+	}
+}
+
+/** Fill with UTF-16 characters; 'rare' out of 256 are non-ASCII */
+static void utf16_fill(char *d, ffsize n, ffuint rare, ffuint be)
+{
+	static const ffushort chars[] = { 0xe9, 0x44f, 0x20ac, 0xd83d, 0xde00, 0xdc00, 0xd800 };
+	for (ffsize i = 0;  i + 1 < n;  i += 2) {
+		ffuint c = 'a' + rnd() % 26;
+		if (rnd() % 256 < rare)
+			c = chars[rnd() % FF_COUNT(chars)];
+		d[i + !be] = c >> 8;
+		d[i + be] = c;
+	}
+}
+
+static double now()
+{
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static void test_id3v2_unsync(ffsize n, ffuint rare)
+{
+	char *src = ffmem_alloc(n + 1), *d1 = ffmem_alloc(n + 1), *d2 = ffmem_alloc(n + 1);
+	unsync_fill(src, n, rare);
+
+	// every split point must produce the same result
+	for (ffsize off = 0;  off != ffmin(n, 40) + 1;  off++) {
+		ffstr in = FFSTR_INITN(src + off, n - off);
+		ffsize r1 = unsync_ref(d1, in.ptr, in.len);
+		ffsize r2 = id3v2_data_decode(d2, in);
+		xieq(r1, r2);
+		x(!ffmem_cmp(d1, d2, r1));
+	}
+
+	ffmem_free(src);
+	ffmem_free(d1);
+	ffmem_free(d2);
+}
+
+static void test_id3v2_utf16(ffsize n, ffuint rare, ffuint be)
+{
+	char *src = ffmem_alloc(n + 1), *d1 = ffmem_alloc(n / 2 * 3 + 1), *d2 = ffmem_alloc(n / 2 * 3 + 1);
+	utf16_fill(src, n, rare, be);
+
+	for (ffsize off = 0;  off <= ffmin(n, 40);  off += 2) {
+		ffsize r1 = utf16_ref(d1, src + off, n - off, be);
+		ffsize r2 = id3v2_utf16_utf8(d2, src + off, n - off, be);
+		xieq(r1, r2);
+		x(!ffmem_cmp(d1, d2, r1));
+	}
+
+	ffmem_free(src);
+	ffmem_free(d1);
+	ffmem_free(d2);
+}
+
+/** Print decoding speed for typical frame sizes: title, comment, lyrics, large binary */
+static void bench_id3v2()
+{
+	static const ffuint sizes[] = { 30, 1024, 64*1024, 1024*1024 };
+	const ffuint *n;
+	FF_FOREACH(sizes, n) {
+		ffsize total = 256*1024*1024, iters = total / *n;
+		char *src = ffmem_alloc(*n), *dst = ffmem_alloc(*n / 2 * 3);
+		double t, t_ref, t_unsync, t_utf16, t_utf16_ref;
+
+		unsync_fill(src, *n, 1);
+		ffstr in = FFSTR_INITN(src, *n);
+		t = now();
+		for (ffsize i = 0;  i != iters;  i++) {
+			unsync_ref(dst, src, *n);
+		}
+		t_ref = now() - t;
+		t = now();
+		for (ffsize i = 0;  i != iters;  i++) {
+			id3v2_data_decode(dst, in);
+		}
+		t_unsync = now() - t;
+
+		utf16_fill(src, *n, 0, 0);
+		t = now();
+		for (ffsize i = 0;  i != iters;  i++) {
+			utf16_ref(dst, src, *n, 0);
+		}
+		t_utf16_ref = now() - t;
+		t = now();
+		for (ffsize i = 0;  i != iters;  i++) {
+			id3v2_utf16_utf8(dst, src, *n, 0);
+		}
+		t_utf16 = now() - t;
+
+		xlog("%7u bytes: unsync %u MB/s (scalar %u MB/s)  utf16 %u MB/s (scalar %u MB/s)"
+			, *n
+			, (ffuint)(256 / ffmax(t_unsync, 1e-6)), (ffuint)(256 / ffmax(t_ref, 1e-6))
+			, (ffuint)(256 / ffmax(t_utf16, 1e-6)), (ffuint)(256 / ffmax(t_utf16_ref, 1e-6)));
+
+		ffmem_free(src);
+		ffmem_free(dst);
+	}
+}
+
+void test_id3v2()
+{
+	static const ffuint sizes[] = { 0, 1, 15, 16, 17, 30, 31, 33, 64, 100, 1024, 64*1024 + 3 };
+	const ffuint *n;
+	FF_FOREACH(sizes, n) {
+		test_id3v2_unsync(*n, 0);
+		test_id3v2_unsync(*n, 4);
+		test_id3v2_unsync(*n, 128);
+		test_id3v2_utf16(*n & ~1U, 0, 0);
+		test_id3v2_utf16(*n, 8, 0);
+		test_id3v2_utf16(*n, 8, 1);
+		test_id3v2_utf16(*n, 200, 1);
+	}
+
+	if (Verbose)
+		bench_id3v2();
+}
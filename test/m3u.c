@@ -4,6 +4,9 @@
 
 #include <avpack/m3u.h>
 #include <test/test.h>
+#include <time.h>
+
+extern int Verbose;
 
 const char m3u_sample[] = { "\
 #EXTM3U\r\n\
@@ -123,6 +126,93 @@ end:
 	m3uread_close(&p);
 }
 
+/** Check entries #i..#n-1 */
+static void m3u_bulk_check(const m3uread_entry *e, ffsize i, ffsize n)
+{
+	static const char *const urls[] = { "URL0", "URL1", "URL2" };
+	static const char *const artists[] = { "ARTIST0", "ARTIST1", "" };
+	static const char *const titles[] = { "TITLE0", "TITLE1", "" };
+	static const int durs[] = { 1, 2, -1 };
+	for (;  i != n;  i++) {
+		xseq(&e[i].url, urls[i]);
+		xseq(&e[i].artist, artists[i]);
+		xseq(&e[i].title, titles[i]);
+		xieq(e[i].duration_sec, durs[i]);
+	}
+}
+
+/** Feed the data by 'chunk' bytes, keeping the unprocessed tail */
+static void m3u_bulk(ffstr data, ffsize chunk, ffsize cap)
+{
+	m3uread p = {};
+	m3uread_open(&p);
+	m3uread_entry ents[3];
+	ffvec buf = {};
+	ffsize off = 0, n = 0;
+
+	while (off != data.len) {
+		ffsize k = ffmin(chunk, data.len - off);
+		ffvec_add(&buf, data.ptr + off, k, 1);
+		off += k;
+
+		ffstr in = FFSTR_INITN(buf.ptr, buf.len);
+		for (;;) {
+			ffsize r = m3uread_bulk(&p, &in, ents + n, ffmin(cap, 3 - n));
+			m3u_bulk_check(ents, n, n + r); // the strings point to 'buf'
+			n += r;
+			if (r == 0)
+				break;
+		}
+		ffmem_move(buf.ptr, in.ptr, in.len);
+		buf.len = in.len;
+	}
+	xieq(n, 3);
+	xieq(buf.len, 0);
+	xieq(m3uread_line(&p), 7);
+
+	ffvec_free(&buf);
+	m3uread_close(&p);
+}
+
+/** Print parsing speed: bulk vs. incremental */
+static void bench_m3u()
+{
+	ffvec d = {};
+	for (ffuint i = 0;  i != 1000000;  i++) {
+		ffvec_addfmt(&d, "#EXTINF:%u,Artist Name %u - Track Title %u\r\nhttp://radio.example.com:8000/stream/%u.mp3\r\n"
+			, i % 1000, i, i, i);
+	}
+
+	m3uread_entry *ents = ffmem_alloc(1000000 * sizeof(m3uread_entry));
+	ffmem_zero(ents, 1000000 * sizeof(m3uread_entry)); // don't measure page faults
+	m3uread p = {};
+	ffstr in = FFSTR_INITN(d.ptr, d.len);
+	clock_t t = clock();
+	ffsize n = m3uread_bulk(&p, &in, ents, 1000000);
+	double t_bulk = (double)(clock() - t) / CLOCKS_PER_SEC;
+	xieq(n, 1000000);
+	m3uread_close(&p);
+
+	ffmem_zero_obj(&p);
+	ffstr_set(&in, d.ptr, d.len);
+	ffstr out;
+	n = 0;
+	t = clock();
+	while (M3UREAD_MORE != m3uread_process(&p, &in, &out)) {
+		n++;
+	}
+	double t_inc = (double)(clock() - t) / CLOCKS_PER_SEC;
+	m3uread_close(&p);
+
+	xlog("m3u parse %uMB: bulk %u MB/s  incremental %u MB/s  (%L)"
+		, (ffuint)(d.len / (1024*1024))
+		, (ffuint)(d.len / (1024*1024) / ffmax(t_bulk, 1e-6))
+		, (ffuint)(d.len / (1024*1024) / ffmax(t_inc, 1e-6)), n);
+
+	ffmem_free(ents);
+	ffvec_free(&d);
+}
+
 void test_m3u()
 {
 	m3u_write();
@@ -131,4 +221,12 @@ void test_m3u()
 	ffstr_set(&data, m3u_sample, sizeof(m3u_sample)-1);
 	m3u_read(data, 0);
 	m3u_read(data, 3);
+
+	m3u_bulk(data, data.len, 3);
+	m3u_bulk(data, data.len, 1);
+	m3u_bulk(data, 1, 3);
+	m3u_bulk(data, 7, 2);
+
+	if (Verbose)
+		bench_m3u();
 }
@@ -9,11 +9,17 @@
 extern void test_apetag();
 extern void test_bmp();
 extern void test_cue();
+extern void test_hls();
 extern void test_icy();
+extern void test_id3v2();
 extern void test_jpg();
 extern void test_m3u();
+extern void test_mmtag();
+extern void test_pcm();
 extern void test_pls();
 extern void test_png();
+extern void test_retag();
+extern void test_ts();
 extern void test_vorbistag();
 extern int test_reader(ffstr data, const char *ext);
 extern void test_writer();
@@ -29,11 +35,17 @@ static const struct test atests[] = {
 	T(bmp),
 	T(cue),
 	T(gather),
+	T(hls),
 	T(icy),
+	T(id3v2),
 	T(jpg),
 	T(m3u),
+	T(mmtag),
+	T(pcm),
 	T(pls),
 	T(png),
+	T(retag),
+	T(ts),
 	T(vorbistag),
 	T(writer),
 };
@@ -0,0 +1,88 @@
+/** avpack: tag name lookup tester
+2026, Simon Zolin
+*/
+
+#include <avpack/vorbistag.h>
+#include <avpack/apetag.h>
+#include <avpack/id3v2.h>
+#include <avpack/base/mp4.h>
+#include <test/test.h>
+#include <time.h>
+
+extern int Verbose;
+
+static void test_mmtag_str(const char *const *names, const ffbyte *tags, ffsize n, int (*find)(const char*, ffsize))
+{
+	for (ffsize i = 0;  i != n;  i++) {
+		ffsize len = ffsz_len(names[i]);
+		xieq(tags[i], find(names[i], len));
+
+		// case-insensitive
+		char buf[64];
+		for (ffsize j = 0;  j != len;  j++) {
+			char c = names[i][j];
+			buf[j] = ((j & 1) && (ffuint)((c | 0x20) - 'a') < 26) ? c ^ 0x20 : c;
+		}
+		xieq(tags[i], find(buf, len));
+
+		// prefix, longer name, wrong character
+		xieq(MMTAG_UNKNOWN, find(names[i], len - 1));
+		ffmem_copy(buf, names[i], len);
+		buf[len] = 'X';
+		xieq(MMTAG_UNKNOWN, find(buf, len + 1));
+		buf[len] = '\0';
+		buf[len - 1] = '@';
+		xieq(MMTAG_UNKNOWN, find(buf, len));
+	}
+	xieq(MMTAG_UNKNOWN, find("", 0));
+	xieq(MMTAG_UNKNOWN, find("ENCODER", 7));
+}
+
+/** Print lookup speed: perfect hash vs. binary search */
+static void bench_mmtag()
+{
+	static const char *const names[] = { "TITLE", "artist", "Album", "ENCODER", "TRACKNUMBER", "replaygain_track_peak" };
+	ffsize iters = 10*1000*1000;
+	ffuint sum = 0;
+
+	clock_t t = clock();
+	for (ffsize i = 0;  i != iters;  i++) {
+		const char *s = names[i % FF_COUNT(names)];
+		sum += vorbistag_find(s, ffsz_len(s));
+	}
+	double t_hash = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+	t = clock();
+	for (ffsize i = 0;  i != iters;  i++) {
+		const char *s = names[i % FF_COUNT(names)];
+		sum += ffszarr_ifindsorted(_vorbistag_str, FF_COUNT(_vorbistag_str), s, ffsz_len(s));
+	}
+	double t_bsearch = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+	xlog("vorbistag lookup: hash %u ns  binary search %u ns  (%u)"
+		, (ffuint)(t_hash * 1e9 / iters), (ffuint)(t_bsearch * 1e9 / iters), sum);
+}
+
+void test_mmtag()
+{
+	test_mmtag_str(_vorbistag_str, _vorbistag_mmtag, FF_COUNT(_vorbistag_str), vorbistag_find);
+	test_mmtag_str(_apetag_str, _apetag_int, FF_COUNT(_apetag_str), apetag_find);
+
+	for (ffsize i = 0;  i != FF_COUNT(_id3v2_frame_str);  i++) {
+		xieq(_id3v2_frame_mmtag[i], id3v2_frame_find(_id3v2_frame_str[i]));
+	}
+	xieq(MMTAG_UNKNOWN, id3v2_frame_find("TXXX"));
+	xieq(MMTAG_UNKNOWN, id3v2_frame_find("tit2"));
+	xieq(MMTAG_UNKNOWN, id3v2_frame_find("TIT\0"));
+
+	for (int i = 0;  ;  i++) {
+		xieq(i, mp4_ilst_box_find(mp4_ctx_ilst[i].type));
+		if (mp4_ctx_ilst[i].flags & MP4_F_LAST)
+			break;
+	}
+	xieq(-1, mp4_ilst_box_find("free"));
+	xieq(-1, mp4_ilst_box_find("\251ALB"));
+
+	if (Verbose)
+		bench_mmtag();
+}
@@ -0,0 +1,52 @@
+/** avpack: PCM utilities tester
+2026, Simon Zolin
+*/
+
+#include <avpack/base/pcm.h>
+#include <test/test.h>
+
+/** Compare pcm_deinterleave() (SIMD kernels, if enabled) with a plain byte copy */
+static void test_pcm_deint(ffuint channels, ffuint sample_size, ffsize samples)
+{
+	enum { GUARD = 32 };
+	ffsize frame = channels * sample_size;
+	char *src = ffmem_alloc(samples * frame);
+	for (ffsize i = 0;  i != samples * frame;  i++) {
+		src[i] = (char)(i * 151 + 7);
+	}
+
+	void *dst[6];
+	for (ffuint c = 0;  c != channels;  c++) {
+		dst[c] = ffmem_alloc(samples * sample_size + GUARD);
+		ffmem_fill(dst[c], 0xcc, samples * sample_size + GUARD);
+	}
+
+	pcm_deinterleave(dst, src, channels, sample_size, samples);
+
+	for (ffuint c = 0;  c != channels;  c++) {
+		const char *d = (char*)dst[c];
+		for (ffsize j = 0;  j != samples;  j++) {
+			x(!ffmem_cmp(d + j * sample_size, src + j * frame + c * sample_size, sample_size));
+		}
+		// nothing is written past the last sample
+		for (ffsize j = samples * sample_size;  j != samples * sample_size + GUARD;  j++) {
+			xieq(0xcc, (ffbyte)d[j]);
+		}
+		ffmem_free(dst[c]);
+	}
+	ffmem_free(src);
+}
+
+void test_pcm()
+{
+	static const ffuint channels[] = { 2, 3, 6 };
+	static const ffuint sizes[] = { 2, 3, 4 };
+	static const ffuint samples[] = { 1, 7, 15, 17, 33, 101, 1001 };
+	for (ffuint ic = 0;  ic != FF_COUNT(channels);  ic++) {
+		for (ffuint is = 0;  is != FF_COUNT(sizes);  is++) {
+			for (ffuint n = 0;  n != FF_COUNT(samples);  n++) {
+				test_pcm_deint(channels[ic], sizes[is], samples[n]);
+			}
+		}
+	}
+}
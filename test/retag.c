@@ -0,0 +1,288 @@
+/** avpack: in-place tag rewrite tester
+2026, Simon Zolin
+*/
+
+#include <avpack/retag.h>
+#include <avpack/flac-read.h>
+#include <avpack/vorbistag.h>
+#include <test/test.h>
+
+static void retag_apply(ffvec *file, struct avpk_retag *r)
+{
+	const struct avpk_patch *p;
+	FFSLICE_WALK(&r->patches, p) {
+		x(p->offset + p->data.len <= file->len);
+		ffmem_copy((char*)file->ptr + p->offset, p->data.ptr, p->data.len);
+	}
+}
+
+/** Read FLAC meta blocks until audio data */
+static ffsize flac_blocks(ffstr data, struct flac_retag_block *blocks, ffsize cap)
+{
+	flacread f = {};
+	flacread_open(&f, 0);
+	ffstr out;
+	ffsize n = 0;
+	for (;;) {
+		int r = flacread_process(&f, &data, &out);
+		if (r == FLACREAD_HEADER_FIN)
+			break;
+		x(r == FLACREAD_HEADER || r == FLACREAD_META_BLOCK);
+		if (r == FLACREAD_META_BLOCK) {
+			x(n != cap);
+			blocks[n].offset = flacread_meta_offset(&f);
+			blocks[n].size = flacread_meta_size(&f);
+			blocks[n].type = flacread_meta_type(&f);
+			n++;
+		}
+	}
+	flacread_close(&f);
+	return n;
+}
+
+static void test_retag_flac()
+{
+	struct flac_info info = { .bits = 16, .channels = 2, .sample_rate = 44100 };
+	ffvec file = {};
+	ffvec_alloc(&file, 4096, 1);
+	char *p = file.ptr;
+	p += flac_info_write(p, 4096, &info);
+
+	vorbistagwrite vw = {};
+	vorbistagwrite_add(&vw, MMTAG_TITLE, FFSTR_Z("old title"));
+	ffstr vt = vorbistagwrite_fin(&vw);
+	p += flac_hdr_write(p, FLAC_TTAGS, 0, vt.len);
+	p = ffmem_copy(p, vt.ptr, vt.len);
+	vorbistagwrite_destroy(&vw);
+	p += flac_padding_write(p, 1000, 1);
+	ffmem_fill(p, 0xff, 16); // audio data
+	p += 16;
+	file.len = p - (char*)file.ptr;
+
+	struct flac_retag_block blocks[8];
+	ffsize n = flac_blocks(*(ffstr*)&file, blocks, 8);
+	xieq(n, 2);
+
+	// new tags + picture
+	ffmem_zero_obj(&vw);
+	vorbistagwrite_add(&vw, MMTAG_TITLE, FFSTR_Z("new title"));
+	vorbistagwrite_add(&vw, MMTAG_ARTIST, FFSTR_Z("artist"));
+	vt = vorbistagwrite_fin(&vw);
+	char pic[300];
+	struct flac_picinfo pi = { .mime = "image/png", .desc = "" };
+	ffstr picdata = FFSTR_INITN("\x89PNG....", 8);
+	int r = flac_pic_write(pic, sizeof(pic), &pi, &picdata, 0);
+	x(r > 0);
+	ffstr pics[1] = { FFSTR_INITN(pic + sizeof(struct flac_hdr), r - sizeof(struct flac_hdr)) };
+
+	struct avpk_retag rt = {};
+	xieq(0, flac_retag(&rt, blocks, n, vt, pics, 1));
+	retag_apply(&file, &rt);
+	avpk_retag_close(&rt);
+
+	struct flac_retag_block blocks2[8];
+	xieq(3, flac_blocks(*(ffstr*)&file, blocks2, 8));
+	xieq(blocks2[0].type, FLAC_TTAGS);
+	xieq(blocks2[0].size, vt.len);
+	x(!ffmem_cmp((char*)file.ptr + blocks2[0].offset + sizeof(struct flac_hdr), vt.ptr, vt.len));
+	xieq(blocks2[1].type, FLAC_TPIC);
+	xieq(blocks2[2].type, FLAC_TPADDING);
+	xieq(blocks2[2].offset + sizeof(struct flac_hdr) + blocks2[2].size, file.len - 16);
+
+	// doesn't fit
+	char big[2000] = {};
+	ffstr bigpic = FFSTR_INITN(big, sizeof(big));
+	xieq(1, flac_retag(&rt, blocks2, 3, vt, &bigpic, 1));
+	xieq(rt.patches.len, 0);
+
+	// keep the picture: only VORBIS_COMMENT block is rewritten
+	xieq(0, flac_retag(&rt, blocks2, 3, vt, NULL, 0));
+	xieq(rt.patches.len, 1);
+	xieq(((struct avpk_patch*)rt.patches.ptr)->offset, blocks2[0].offset);
+	avpk_retag_close(&rt);
+
+	vorbistagwrite_destroy(&vw);
+	ffvec_free(&file);
+}
+
+static void test_retag_id3v2()
+{
+	struct id3v2write w = {};
+	id3v2write_create(&w);
+	id3v2write_add(&w, MMTAG_TITLE, FFSTR_Z("old"), 0);
+	id3v2write_finish(&w, 200);
+	ffuint tag_size = w.buf.len;
+	id3v2write_close(&w);
+
+	ffmem_zero_obj(&w);
+	id3v2write_create(&w);
+	id3v2write_add(&w, MMTAG_TITLE, FFSTR_Z("new title"), 0);
+	id3v2write_add(&w, MMTAG_ARTIST, FFSTR_Z("artist"), 0);
+	id3v2write_add(&w, MMTAG_TRACKNO, FFSTR_Z("1"), 0);
+
+	struct avpk_retag rt = {};
+	xieq(0, id3v2_retag(&rt, tag_size, &w));
+	xieq(rt.patches.len, 1);
+	const struct avpk_patch *p = (struct avpk_patch*)rt.patches.ptr;
+	xieq(p->offset, 0);
+	xieq(p->data.len, tag_size);
+
+	struct id3v2_hdr h;
+	x(id3v2_hdr_read(&h, p->data) >= 0);
+	xieq(h.size, tag_size);
+	x(!ffmem_cmp(p->data.ptr + sizeof(struct id3v2_taghdr), (char*)w.buf.ptr + sizeof(struct id3v2_taghdr), w.buf.len - sizeof(struct id3v2_taghdr)));
+	avpk_retag_close(&rt);
+	id3v2write_close(&w);
+
+	// doesn't fit
+	ffmem_zero_obj(&w);
+	id3v2write_create(&w);
+	char big[300] = {};
+	ffstr comment = FFSTR_INITN(big, sizeof(big));
+	id3v2write_add(&w, MMTAG_COMMENT, comment, 0);
+	xieq(1, id3v2_retag(&rt, tag_size, &w));
+	id3v2write_close(&w);
+}
+
+/** Append MP4 box with data */
+static void mp4_box_add(ffvec *buf, const char *type, const void *data, ffsize n)
+{
+	ffvec_grow(buf, 8 + n, 1);
+	char *p = (char*)buf->ptr + buf->len;
+	mp4_box_write(type, p, n);
+	ffmem_copy(p + 8, data, n);
+	buf->len += 8 + n;
+}
+
+/** The old "ilst" of 'size' bytes: "\251nam" box with padding data */
+static void mp4_old_ilst(ffvec *buf, ffsize size)
+{
+	char d[256] = {};
+	buf->len = 0;
+	mp4_box_add(buf, "ilst", NULL, 0);
+	if (size != 8)
+		mp4_box_add(buf, "\251nam", d, size - 16);
+	mp4_box_write("ilst", buf->ptr, buf->len - 8);
+}
+
+static void test_retag_mp4()
+{
+	mp4write m = {};
+	ffvec ilst = {}, old = {};
+	mp4write_addtag(&m, MMTAG_TITLE, FFSTR_Z("title"));
+	mp4write_addtag(&m, MMTAG_ARTIST, FFSTR_Z("artist"));
+	mp4write_addtag(&m, MMTAG_TRACKNO, FFSTR_Z("3"));
+	xieq(1, mp4write_addtag(&m, MMTAG_PICTURE, FFSTR_Z("image")));
+	xieq(0, mp4write_ilst(&m, &ilst));
+	xieq(ffint_be_cpu32_ptr(ilst.ptr), ilst.len);
+	x(!ffmem_cmp(ilst.ptr + 4, "ilst", 4));
+	// boxes are in the order of mp4_ctx_ilst: "trkn" "\251ART" "\251nam"
+	x(!ffmem_cmp(ilst.ptr + 8 + 4, "trkn", 4));
+	mp4write_close(&m);
+
+	struct avpk_retag rt = {};
+	mp4_old_ilst(&old, ilst.len - 8);
+	xieq(0, mp4_retag(&rt, 1000, *(ffstr*)&old, 8, *(ffstr*)&ilst));
+	xieq(rt.patches.len, 1);
+	const struct avpk_patch *p = (struct avpk_patch*)rt.patches.ptr;
+	x(ffstr_eq(&p->data, ilst.ptr, ilst.len));
+	avpk_retag_close(&rt);
+
+	mp4_old_ilst(&old, 16);
+	xieq(0, mp4_retag(&rt, 1000, *(ffstr*)&old, ilst.len + 100, *(ffstr*)&ilst));
+	p = (struct avpk_patch*)rt.patches.ptr;
+	xieq(p->offset, 1000);
+	xieq(p->data.len, ilst.len + 8);
+	xieq(ffint_be_cpu32_ptr(p->data.ptr + ilst.len), 16 + 100);
+	x(!ffmem_cmp(p->data.ptr + ilst.len + 4, "free", 4));
+	avpk_retag_close(&rt);
+
+	// the remaining space can't hold "free" box header
+	mp4_old_ilst(&old, ilst.len);
+	xieq(1, mp4_retag(&rt, 1000, *(ffstr*)&old, 4, *(ffstr*)&ilst));
+	mp4_old_ilst(&old, ilst.len - 8);
+	xieq(1, mp4_retag(&rt, 1000, *(ffstr*)&old, 0, *(ffstr*)&ilst));
+
+	// "covr", "disk", an unknown box and an iTunes box with another name are kept;
+	//  the old title is replaced
+	ffvec data = {}, itunes = {}, covr = {}, disk = {}, smpb = {};
+	char mean[4 + 16] = {}, name[4 + 8] = {}, val[8 + 5] = {};
+	ffmem_copy(mean + 4, "com.apple.iTunes", 16);
+	ffmem_copy(val + 8, "image", 5);
+	mp4_box_add(&data, "data", val, sizeof(val));
+	mp4_box_add(&covr, "covr", data.ptr, data.len);
+	mp4_box_add(&disk, "disk", data.ptr, data.len);
+	mp4_box_add(&itunes, "mean", mean, sizeof(mean));
+	ffmem_copy(name + 4, "iTunSMPB", 8);
+	mp4_box_add(&smpb, "mean", mean, sizeof(mean));
+	mp4_box_add(&smpb, "name", name, sizeof(name));
+	mp4_box_add(&smpb, "data", val, sizeof(val));
+	ffmem_copy(name + 4, "MYCUSTOM", 8);
+	mp4_box_add(&itunes, "name", name, sizeof(name));
+	mp4_box_add(&itunes, "data", val, sizeof(val));
+
+	old.len = 0;
+	mp4_box_add(&old, "ilst", NULL, 0);
+	mp4_box_add(&old, "covr", data.ptr, data.len);
+	mp4_box_add(&old, "\251nam", data.ptr, data.len);
+	mp4_box_add(&old, "disk", data.ptr, data.len);
+	mp4_box_add(&old, "----", smpb.ptr, smpb.len);
+	mp4_box_add(&old, "----", itunes.ptr, itunes.len);
+	mp4_box_add(&old, "zzzz", data.ptr, data.len);
+	mp4_box_write("ilst", old.ptr, old.len - 8);
+	ffsize kept = covr.len + disk.len + (8 + itunes.len) + (8 + data.len);
+
+	// iTunSMPB is replaced by the new one
+	m = (mp4write){};
+	m.info.total_samples = 1000;
+	mp4write_addtag(&m, MMTAG_TITLE, FFSTR_Z("title"));
+	ilst.len = 0;
+	xieq(0, mp4write_ilst(&m, &ilst));
+	mp4write_close(&m);
+
+	xieq(0, mp4_retag(&rt, 1000, *(ffstr*)&old, 1000, *(ffstr*)&ilst));
+	p = (struct avpk_patch*)rt.patches.ptr;
+	xieq(p->data.len, ilst.len + kept + 8);
+	xieq(ffint_be_cpu32_ptr(p->data.ptr), ilst.len + kept);
+	x(!ffmem_cmp(p->data.ptr + 4, "ilst", 4));
+	x(!ffmem_cmp(p->data.ptr + 8, ilst.ptr + 8, ilst.len - 8));
+	const char *k = p->data.ptr + ilst.len;
+	x(!ffmem_cmp(k, covr.ptr, covr.len));
+	k += covr.len;
+	x(!ffmem_cmp(k, disk.ptr, disk.len));
+	k += disk.len;
+	x(!ffmem_cmp(k + 4, "----", 4));
+	x(!ffmem_cmp(k + 8, itunes.ptr, itunes.len));
+	k += 8 + itunes.len;
+	x(!ffmem_cmp(k + 4, "zzzz", 4));
+	k += 8 + data.len;
+	xieq(ffint_be_cpu32_ptr(k), old.len + 1000 - ilst.len - kept);
+	x(!ffmem_cmp(k + 4, "free", 4));
+	avpk_retag_close(&rt);
+
+	// the new tags alone would fit, but not with the kept "covr"
+	ffvec old2 = {};
+	mp4_box_add(&old2, "ilst", covr.ptr, covr.len);
+	xieq(1, mp4_retag(&rt, 1000, *(ffstr*)&old2, ilst.len - old2.len, *(ffstr*)&ilst));
+	xieq(rt.patches.len, 0);
+	ffvec_free(&old2);
+
+	// the old box can't be parsed
+	*(ffuint*)(old.ptr + 8) = ffint_be_cpu32(old.len);
+	xieq(1, mp4_retag(&rt, 1000, *(ffstr*)&old, 1000, *(ffstr*)&ilst));
+
+	ffvec_free(&data);
+	ffvec_free(&itunes);
+	ffvec_free(&covr);
+	ffvec_free(&disk);
+	ffvec_free(&smpb);
+	ffvec_free(&old);
+	ffvec_free(&ilst);
+}
+
+void test_retag()
+{
+	test_retag_flac();
+	test_retag_id3v2();
+	test_retag_mp4();
+}
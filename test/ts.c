@@ -0,0 +1,148 @@
+/** avpack: .ts reader tester
+2026, Simon Zolin
+*/
+
+#include <avpack/ts-read.h>
+#include <test/test.h>
+
+enum {
+	TS_PES_N = 2000,
+	TS_PES_MSEC = 20,
+	TS_PID = 0x101,
+	TS_PAYLOAD = 170, // PES data in one packet after the header
+};
+
+// PTS wraps around after 10sec
+#define TS_PTS_FIRST  ((1ULL << 33) - 10000*90)
+
+static void ts_pkt_hdr(ffbyte *d, ffuint pid, ffuint counter)
+{
+	ffmem_fill(d, 0xff, 188);
+	d[0] = 0x47;
+	d[1] = 0x40 | (pid >> 8);
+	d[2] = pid & 0xff;
+	d[3] = 0x10 | (counter & 0x0f);
+	d[4] = 0x00; // pointer field
+}
+
+/** PAT, PMT, then one single-packet PES per frame */
+static void ts_gen(ffvec *buf)
+{
+	static const ffbyte pat[] = {
+		0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00,
+		0x00, 0x01, 0xe1, 0x00, // program 1 -> PMT PID 0x100
+	};
+	static const ffbyte pmt[] = {
+		0x02, 0xb0, 0x12, 0x00, 0x01, 0xc1, 0x00, 0x00,
+		0xe1, 0x01, 0xf0, 0x00, // PCR PID 0x101, no program info
+		TS_STREAM_AUDIO_MP3, 0xe1, 0x01, 0xf0, 0x00,
+	};
+
+	ffvec_alloc(buf, (2 + TS_PES_N) * 188, 1);
+	ffbyte *d = (ffbyte*)buf->ptr;
+
+	ts_pkt_hdr(d, 0, 0);
+	ffmem_copy(d + 5, pat, sizeof(pat));
+	d += 188;
+
+	ts_pkt_hdr(d, 0x100, 0);
+	ffmem_copy(d + 5, pmt, sizeof(pmt));
+	d += 188;
+
+	for (ffuint i = 0;  i < TS_PES_N;  i++) {
+		ffuint64 pts = (TS_PTS_FIRST + (ffuint64)i * TS_PES_MSEC * 90) & ((1ULL << 33) - 1);
+		ts_pkt_hdr(d, TS_PID, i);
+		ffbyte *p = d + 5;
+		p[0] = 0x00;  p[1] = 0x01; // the first 0x00 of start code is the pointer field
+		p[2] = 0xc0;
+		p[3] = 0;  p[4] = 3 + 5 + TS_PAYLOAD;
+		p[5] = 0x80;  p[6] = 0x80;  p[7] = 5;
+		p[8] = 0x21 | ((pts >> 29) & 0x0e);
+		p[9] = pts >> 22;
+		p[10] = ((pts >> 14) & 0xfe) | 1;
+		p[11] = pts >> 7;
+		p[12] = ((pts << 1) & 0xfe) | 1;
+		ffmem_fill(p + 13, i & 0xff, TS_PAYLOAD);
+		d += 188;
+	}
+	buf->len = (2 + TS_PES_N) * 188;
+}
+
+/** Read the next frame
+Return frame index */
+static ffuint ts_next(tsread *t, ffstr data, ffuint64 *off, ffstr *in)
+{
+	for (;;) {
+		ffstr out = {};
+		int r = tsread_process(t, in, &out);
+		switch (r) {
+		case TSREAD_DATA:
+			xieq(TS_PAYLOAD, out.len);
+			return (ffbyte)out.ptr[0];
+
+		case TSREAD_SEEK:
+			*off = tsread_seek_offset(t);
+			x(*off < data.len);
+			// fallthrough
+		case TSREAD_MORE:
+			x(*off < data.len);
+			in->ptr = data.ptr + *off;
+			in->len = ffmin(data.len - *off, 1000); // not aligned to packet size
+			*off += in->len;
+			break;
+
+		case TSREAD_WARN:
+			xlog("WARNING  %s", tsread_error(t));
+			break;
+
+		default:
+			xlog("ERROR  %s", tsread_error(t));
+			x(0);
+			return ~0U;
+		}
+	}
+}
+
+void test_ts()
+{
+	ffvec buf = {};
+	ts_gen(&buf);
+	ffstr data = FFSTR_INITN(buf.ptr, buf.len);
+
+	tsread t = {};
+	tsread_open(&t, data.len);
+	ffuint64 off = 0;
+	ffstr in = {};
+
+	// positions are relative to the first PES and continue after PTS wraparound
+	ffuint64 pos[TS_PES_N];
+	for (ffuint i = 0;  i < TS_PES_N;  i++) {
+		xieq(i & 0xff, ts_next(&t, data, &off, &in));
+		pos[i] = tsread_pos_msec(&t);
+		xieq(i * TS_PES_MSEC, pos[i]);
+	}
+
+	// seek to a reported position: the reader starts before it
+	//  (within the probe precision or within the file tail),
+	//  and the frame at this position is found after skipping a few PES
+	static const ffuint targets[] = { 1500, 0, 499, 500, 777, 1999, 3 };
+	for (ffuint k = 0;  k < FF_COUNT(targets);  k++) {
+		ffuint i = targets[k];
+		tsread_seek(&t, pos[i]);
+		ffuint n = 0;
+		for (;;) {
+			ffuint idx = ts_next(&t, data, &off, &in);
+			x(idx != ~0U);
+			xieq((tsread_pos_msec(&t) / TS_PES_MSEC) & 0xff, idx);
+			if (n++ == 0)
+				x(tsread_pos_msec(&t) <= pos[i]);
+			if (tsread_pos_msec(&t) >= pos[i])
+				break;
+		}
+		xieq(pos[i], tsread_pos_msec(&t));
+		x(n <= _TSR_SEEK_TAIL / 188 + 1);
+	}
+
+	tsread_close(&t);
+	ffvec_free(&buf);
+}
@@ -3,8 +3,170 @@
 */
 
 #include <avpack/vorbistag.h>
+#include <avpack/reader.h>
+#include <avpack/flac-read.h>
+#include <avpack/ogg-codec-read.h>
+#include <avpack/ogg-write.h>
 #include <test/test.h>
 
+/** Feed the data in chunks of 'chunk' bytes */
+static void test_vorbistag_partial(ffstr d, ffsize chunk, ffuint field_max, const ffuint *tags, ffuint ntags)
+{
+	vorbistagread vr = {};
+	vr.partial = 1;
+	vr.field_max = field_max;
+	ffstr name, val;
+	ffuint i = 0;
+	ffsize off = 0;
+	ffstr in = {};
+	for (;;) {
+		int r = vorbistagread_process(&vr, &in, &name, &val);
+		if (r == VORBISTAGREAD_DONE)
+			break;
+		if (r == VORBISTAGREAD_MORE) {
+			x(in.len == 0);
+			x(off != d.len);
+			ffstr_set(&in, d.ptr + off, ffmin(chunk, d.len - off));
+			off += in.len;
+			continue;
+		}
+		x(i != ntags);
+		xieq(tags[i++], r);
+		if (r == MMTAG_TITLE)
+			xseq(&val, "title");
+	}
+	xieq(i, ntags);
+	x(vr.buf.cap <= ffmax(field_max, 4));
+	vorbistagread_close(&vr);
+}
+
+struct vtag_result {
+	ffuint tags[16];
+	ffuint ntags;
+	ffuint warnings;
+};
+
+/** Read tags with avpk_read(), feeding the data in chunks of 'chunk' bytes */
+static void test_vorbistag_avpk(const struct avpkr_if *rif, ffstr data, ffsize chunk, struct vtag_result *t)
+{
+	struct avpk_reader_conf c = {};
+	avpk_reader ar = {};
+	x(!avpk_open(&ar, rif, &c));
+	ffsize off = 0;
+	ffstr in = {};
+	for (;;) {
+		union avpk_read_result res = {};
+		int r = avpk_read(&ar, &in, &res);
+		switch (r) {
+		case AVPK_META:
+			x(t->ntags != FF_COUNT(t->tags));
+			t->tags[t->ntags++] = res.tag.id;
+			if (res.tag.id == MMTAG_TITLE)
+				xseq(&res.tag.value, "title");
+			break;
+
+		case AVPK_WARNING:
+			xlog("WARNING  %s", res.error.message);
+			t->warnings++;
+			break;
+
+		case AVPK_MORE:
+			if (off == data.len)
+				goto end;
+			ffstr_set(&in, data.ptr + off, ffmin(chunk, data.len - off));
+			off += in.len;
+			break;
+
+		case AVPK_HEADER:
+		case AVPK_DATA:
+			break;
+
+		default:
+			x(0);
+			goto end;
+		}
+	}
+
+end:
+	avpk_close(&ar);
+}
+
+/** FLAC stream info and VORBIS_COMMENT block with 'n' bytes of 'tags' */
+static void test_vorbistag_flac_gen(ffvec *buf, ffstr tags, ffsize n)
+{
+	struct flac_info fi = {
+		.bits = 16,
+		.channels = 2,
+		.sample_rate = 48000,
+	};
+	buf->len = 0;
+	ffvec_grow(buf, FLAC_HDR_MINSIZE + sizeof(struct flac_hdr) + n, 1);
+	buf->len = flac_info_write(buf->ptr, buf->cap, &fi);
+	buf->len += flac_hdr_write((char*)buf->ptr + buf->len, FLAC_TTAGS, 1, n);
+	ffvec_add(buf, tags.ptr, n, 1);
+}
+
+/** Opus header and comment packets with 'n' bytes of 'tags' */
+static void test_vorbistag_ogg_gen(ffvec *buf, ffuint serial, ffstr tags, ffsize n)
+{
+	oggwrite o = {};
+	oggwrite_create(&o, serial, 0);
+	char hdr[32];
+	ffvec pkt = {};
+	ffstr in, out;
+
+	ffstr_set(&in, hdr, opus_hdr_write(hdr, sizeof(hdr), 2, 48000, 0));
+	xieq(OGGWRITE_DATA, oggwrite_process(&o, &in, &out, 0, OGGWRITE_FFLUSH));
+	ffvec_add(buf, out.ptr, out.len, 1);
+
+	ffvec_alloc(&pkt, 8 + n, 1);
+	pkt.len = opus_tags_write(pkt.ptr, pkt.cap, 0);
+	ffvec_add(&pkt, tags.ptr, n, 1);
+	ffstr_set(&in, pkt.ptr, pkt.len);
+	xieq(OGGWRITE_DATA, oggwrite_process(&o, &in, &out, 0, OGGWRITE_FLAST));
+	ffvec_add(buf, out.ptr, out.len, 1);
+
+	ffvec_free(&pkt);
+	oggwrite_close(&o);
+}
+
+/** Tags from FLAC (chunked VORBIS_COMMENT block) and Ogg via avpk_read() */
+static void test_vorbistag_avpk_formats(ffstr d, const ffuint *ids, ffuint n)
+{
+	ffvec buf = {};
+	struct vtag_result t;
+
+	test_vorbistag_flac_gen(&buf, d, d.len);
+	static const ffsize chunks[] = { 1, 5, 64, 100000 };
+	for (ffuint i = 0;  i != FF_COUNT(chunks);  i++) {
+		t = (struct vtag_result){};
+		test_vorbistag_avpk(&avpk_flac, *(ffstr*)&buf, chunks[i], &t);
+		xieq(n, t.ntags);
+		x(!ffmem_cmp(t.tags, ids, n * sizeof(ffuint)));
+		xieq(0, t.warnings);
+	}
+
+	// the block ends in the middle of a field
+	test_vorbistag_flac_gen(&buf, d, d.len - 3);
+	t = (struct vtag_result){};
+	test_vorbistag_avpk(&avpk_flac, *(ffstr*)&buf, 5, &t);
+	xieq(n - 1, t.ntags);
+	xieq(1, t.warnings);
+
+	// truncated comment packet in the first logical stream;
+	//  the tags of the next stream are read from the start
+	buf.len = 0;
+	test_vorbistag_ogg_gen(&buf, 1, d, d.len - 3);
+	test_vorbistag_ogg_gen(&buf, 2, d, d.len);
+	t = (struct vtag_result){};
+	test_vorbistag_avpk(&avpk_ogg, *(ffstr*)&buf, 64, &t);
+	xieq(1, t.warnings);
+	x(t.ntags >= n);
+	x(!ffmem_cmp(t.tags + t.ntags - n, ids, n * sizeof(ffuint)));
+
+	ffvec_free(&buf);
+}
+
 void test_vorbistag()
 {
 	struct tag {
@@ -38,5 +200,26 @@ void test_vorbistag()
 	}
 	xieq(ntags, FF_COUNT(tags));
 
+	ffuint ids[FF_COUNT(tags) + 1];
+	for (ffuint i = 0;  i != FF_COUNT(tags);  i++) {
+		ids[i] = tags[i].name;
+	}
+	d = vorbistagwrite_fin(&vw);
+	test_vorbistag_partial(d, 1, 64, ids, FF_COUNT(tags));
+	test_vorbistag_partial(d, 7, 64, ids, FF_COUNT(tags));
+	test_vorbistag_partial(d, d.len, 64, ids, FF_COUNT(tags));
+	test_vorbistag_avpk_formats(d, ids, FF_COUNT(tags));
+
+	// large field is skipped
+	char big[1000];
+	ffmem_fill(big, 'x', sizeof(big));
+	ffstr bigval = FFSTR_INITN(big, sizeof(big));
+	vorbistagwrite_add_name(&vw, FFSTR_Z("METADATA_BLOCK_PICTURE"), bigval);
+	vorbistagwrite_add(&vw, MMTAG_GENRE, FFSTR_Z("genre"));
+	ids[FF_COUNT(tags)] = MMTAG_GENRE;
+	d = vorbistagwrite_fin(&vw);
+	test_vorbistag_partial(d, 5, 64, ids, FF_COUNT(tags) + 1);
+	test_vorbistag_partial(d, 300, 64, ids, FF_COUNT(tags) + 1);
+
 	vorbistagwrite_destroy(&vw);
 }
@@ -3,11 +3,13 @@
 
 #include <avpack/writer.h>
 #include <avpack/mmtag.h>
+#include <avpack/caf-write.h>
 #include <avpack/flac-write.h>
 #include <avpack/mp3-write.h>
 #include <avpack/mp4-write.h>
 #include <avpack/ogg-write.h>
 #include <avpack/wav-write.h>
+#include <avpack/wav-read.h>
 #include <test/test.h>
 
 
@@ -23,6 +25,7 @@ static const char ret_str[][14] = {
 };
 
 static const struct avpkw_if *const avpkw_formats[] = {
+	&avpkw_caf,
 	&avpkw_flac,
 	&avpkw_mp3,
 	&avpkw_mp4,
@@ -84,11 +87,255 @@ fin:
 	avpk_writer_close(&w);
 }
 
+/** "esds" descriptor sizes >= 128 use the multi-byte form */
+static void test_caf_esds()
+{
+	char conf[200], esds[300];
+	ffmem_fill(conf, 0x11, sizeof(conf));
+	struct caf_mp4_acodec ac = {
+		.type = 0x40,
+		.stm_type = 0x15,
+		.conf = conf,
+		.conflen = sizeof(conf),
+	};
+	int n = caf_mp4_esds_write(NULL, &ac);
+	x(n > 0 && n <= (int)sizeof(esds));
+	xieq(n, caf_mp4_esds_write(esds, &ac));
+
+	struct caf_mp4_acodec ac2 = {};
+	xieq(0, caf_mp4_esds_read(esds, n, &ac2));
+	xieq(ac2.conflen, sizeof(conf));
+	x(!ffmem_cmp(ac2.conf, conf, sizeof(conf)));
+	x(0 != caf_mp4_esds_read(esds, n - 10, &ac2)); // codec config is truncated
+}
+
+/** Xing tag: frames, bytes, TOC */
+static void test_mp3_xing()
+{
+	enum { N = 300 };
+	static char data[417 + N * 522 + 128];
+	ffuint offs[N], off = 0, len = 0, nbytes = 0, i = 0;
+	char frame[522] = {};
+
+	mp3write m = {};
+	mp3write_create(&m);
+	m.options = MP3WRITE_XINGTAG | MP3WRITE_ID3V1;
+
+	ffstr in = {}, out;
+	for (;;) {
+		if (in.len == 0 && i < N) {
+			// 160 kbps, then 3 frames of 128 kbps
+			ffbyte h[4] = { 0xff, 0xfb, (i % 4 == 0) ? 0xa0 : 0x90, 0x00 };
+			ffmem_copy(frame, h, 4);
+			ffstr_set(&in, frame, mpeg1_size(h));
+			offs[i++] = nbytes;
+			nbytes += in.len;
+		}
+		int r = mp3write_process(&m, &in, &out, (i == N) ? MP3WRITE_FLAST : 0);
+		if (r == MP3WRITE_DONE)
+			break;
+		switch (r) {
+		case MP3WRITE_DATA:
+			x(off + out.len <= sizeof(data));
+			ffmem_copy(data + off, out.ptr, out.len);
+			off += out.len;
+			len = ffmax(len, off);
+			break;
+		case MP3WRITE_SEEK:
+			off = mp3write_offset(&m);
+			break;
+		case MP3WRITE_MORE:
+			break;
+		default:
+			x(0);
+			goto end;
+		}
+	}
+
+	const ffuint hdr_size = 417; // Xing frame is 128 kbps
+	xieq(hdr_size + nbytes + 128, len);
+	x(!ffmem_cmp(data + len - 128, "TAG", 3));
+
+	struct mpeg1_info info = {};
+	x(mpeg1_xing_read(&info, data, hdr_size) > 0);
+	xieq(N, info.frames);
+	xieq(hdr_size + nbytes, info.bytes);
+	x(info.toc[99] != 0);
+
+	// TOC resolution is 1/256 of the stream size
+	const ffuint64 total_samples = N * 1152;
+	for (i = 0;  i < N;  i += 37) {
+		ffuint64 o = mpeg1_xing_seek(info.toc, i * 1152, total_samples, info.bytes);
+		ffint64 d = (ffint64)o - (ffint64)(hdr_size + offs[i]);
+		x(d <= (ffint64)info.bytes / 256 + 522 && -d <= (ffint64)info.bytes / 256 + 522);
+	}
+
+end:
+	mp3write_close(&m);
+}
+
+/** Data size > 4GB: the final header is RF64 with ds64 chunk */
+static void test_wav_rf64()
+{
+	struct wav_info info = {
+		.format = 16,
+		.sample_rate = 48000,
+		.channels = 2,
+	};
+	wavwrite w = {};
+	wavwrite_create(&w, &info);
+
+	ffstr in = {}, out;
+	xieq(WAVWRITE_DATA, wavwrite_process(&w, &in, &out));
+	ffuint hdr_len = out.len;
+	x(!ffmem_cmp(out.ptr, "RIFF", 4));
+
+	ffstr_set(&in, "\x01\x02\x03\x04", 4);
+	xieq(WAVWRITE_DATA, wavwrite_process(&w, &in, &out));
+	xieq(WAVWRITE_MORE, wavwrite_process(&w, &in, &out));
+
+	// pretend that 5GB of data is written
+	const ffuint64 dsize = 5ULL*1024*1024*1024;
+	w.dsize = dsize;
+	wavwrite_finish(&w);
+	xieq(WAVWRITE_SEEK, wavwrite_process(&w, &in, &out));
+	xieq(0, wavwrite_offset(&w));
+	xieq(WAVWRITE_DATA, wavwrite_process(&w, &in, &out));
+	xieq(hdr_len, out.len); // ds64 replaces JUNK
+	xieq(WAVWRITE_DONE, wavwrite_process(&w, &in, &out));
+
+	const char *h = out.ptr;
+	x(!ffmem_cmp(h, "RF64", 4));
+	xieq(0xffffffff, ffint_le_cpu32_ptr(h + 4));
+	x(!ffmem_cmp(h + 12, "ds64", 4));
+	ffuint64 riff_size, data_size;
+	xieq(0, wav_ds64_read(h + 20, sizeof(struct wav_ds64), &riff_size, &data_size));
+	xieq(hdr_len + dsize - 8, riff_size);
+	xieq(dsize, data_size);
+	x(!ffmem_cmp(h + hdr_len - 8, "data", 4));
+	xieq(0xffffffff, ffint_le_cpu32_ptr(h + hdr_len - 4));
+
+	// the reader takes the sizes from ds64
+	wavread r = {};
+	wavread_open(&r);
+	ffstr hdr = FFSTR_INITN(out.ptr, out.len);
+	xieq(WAVREAD_HEADER, wavread_process(&r, &hdr, &out));
+	xieq(dsize / 4, wavread_info(&r)->total_samples);
+	xieq(dsize, r.datasize);
+	xieq(0, r.inf_data);
+	wavread_close(&r);
+
+	wavwrite_close(&w);
+}
+
+/** Aligned mode: every write is aligned; the data is followed by JUNK chunk */
+static void test_wav_aligned()
+{
+	enum { ALIGN = 4096, DSIZE = 100001 };
+	static char img[256*1024];
+	static char data[DSIZE];
+	for (ffuint i = 0;  i < DSIZE;  i++) {
+		data[i] = (char)(i * 7);
+	}
+
+	struct wav_info info = {
+		.format = 8,
+		.sample_rate = 48000,
+		.channels = 1,
+	};
+	wavwrite w = {};
+	wavwrite_create(&w, &info);
+	w.align = ALIGN;
+
+	ffuint64 off = 0, len = 0, data_off = ~0ULL;
+	ffstr in = {}, out;
+	ffsize i = 0;
+	for (;;) {
+		int r = wavwrite_process(&w, &in, &out);
+		if (r == WAVWRITE_DONE)
+			break;
+		switch (r) {
+		case WAVWRITE_DATA:
+			xieq(0, off % ALIGN);
+			xieq(0, out.len % ALIGN);
+			xieq(0, (ffsize)out.ptr % ALIGN);
+			x(off + out.len <= sizeof(img));
+			if (off != 0 && data_off == ~0ULL)
+				data_off = off;
+			ffmem_copy(img + off, out.ptr, out.len);
+			off += out.len;
+			len = ffmax(len, off);
+			break;
+		case WAVWRITE_SEEK:
+			off = wavwrite_offset(&w);
+			xieq(0, off % ALIGN);
+			break;
+		case WAVWRITE_MORE: {
+			// odd-sized input
+			ffsize n = ffmin(999, DSIZE - i);
+			ffstr_set(&in, data + i, n);
+			i += n;
+			if (i == DSIZE)
+				wavwrite_finish(&w);
+			break;
+		}
+		default:
+			x(0);
+			goto end;
+		}
+	}
+
+	// the header is followed by data at aligned offset
+	xieq(w.doff, data_off);
+	x(!ffmem_cmp(img + w.doff - 8, "data", 4));
+	xieq(DSIZE, ffint_le_cpu32_ptr(img + w.doff - 4));
+	x(!ffmem_cmp(img + w.doff, data, DSIZE));
+
+	// [pad byte] JUNK chunk up to the end of file
+	ffuint64 junk = w.doff + DSIZE + 1;
+	xieq(0, img[junk - 1]);
+	x(!ffmem_cmp(img + junk, "JUNK", 4));
+	xieq(len, junk + 8 + ffint_le_cpu32_ptr(img + junk + 4));
+	x(!ffmem_cmp(img, "RIFF", 4));
+	xieq(len, 8 + ffint_le_cpu32_ptr(img + 4));
+
+	// the reader gets all data and reaches the end of RIFF chunk
+	wavread r = {};
+	wavread_open(&r);
+	ffstr rin = FFSTR_INITN(img, len), rout;
+	ffsize rdata = 0;
+	for (;;) {
+		int rr = wavread_process(&r, &rin, &rout);
+		if (rr == WAVREAD_DATA) {
+			x(!ffmem_cmp(rout.ptr, data + rdata, rout.len));
+			rdata += rout.len;
+		} else if (rr == WAVREAD_DONE) {
+			break;
+		} else if (rr != WAVREAD_HEADER) {
+			x(0);
+			break;
+		}
+	}
+	xieq(DSIZE, rdata);
+	wavread_close(&r);
+
+end:
+	wavwrite_close(&w);
+}
+
 void test_writer()
 {
+	test_caf_esds();
+	test_mp3_xing();
+	test_wav_rf64();
+	test_wav_aligned();
+
 	char data[64*1024];
 	ffstr buf = { 0, data };
 
+	test_writer_ext(&buf, "caf");
+	file_writeall("avpk-test.caf", buf.ptr, buf.len);
+
 	test_writer_ext(&buf, "flac");
 	file_writeall("avpk-test.flac", buf.ptr, buf.len);
 